@@ -0,0 +1,60 @@
+// Creates a ccl process group from C++ without Python and times allreduce
+// from 4B to 64MB, e.g.
+//   mpirun -np 2 ./allreduce_bench
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <torch/torch.h>
+#include <torch/csrc/distributed/c10d/TCPStore.hpp>
+
+#include <process_group_factory.h>
+
+static int envInt(const char* name, const char* fallback, int defaultValue) {
+  const char* value = std::getenv(name);
+  if (value == nullptr) {
+    value = std::getenv(fallback);
+  }
+  return value ? std::atoi(value) : defaultValue;
+}
+
+int main() {
+  int rank = envInt("RANK", "PMI_RANK", 0);
+  int size = envInt("WORLD_SIZE", "PMI_SIZE", 1);
+  const char* addr = std::getenv("MASTER_ADDR");
+  int port = envInt("MASTER_PORT", "MASTER_PORT", 29500);
+
+  c10d::TCPStoreOptions storeOptions;
+  storeOptions.port = port;
+  storeOptions.isServer = rank == 0;
+  storeOptions.numWorkers = size;
+  auto store = c10::make_intrusive<c10d::TCPStore>(addr ? addr : "127.0.0.1", storeOptions);
+  auto pg = oneccl_bindings_for_pytorch::createProcessGroup(store, rank, size);
+
+  // Correctness first: every rank adds its rank + 1.
+  std::vector<at::Tensor> check = {torch::full({16}, rank + 1.0f)};
+  pg->allreduce(check)->wait();
+  float expected = size * (size + 1) / 2.0f;
+  TORCH_CHECK(check[0].eq(expected).all().item<bool>(), "allreduce returned a wrong sum");
+
+  const int warm = 10;
+  const int iters = 100;
+  for (int64_t bytes = 4; bytes <= (64 << 20); bytes *= 4) {
+    std::vector<at::Tensor> tensors = {torch::ones({bytes / 4})};
+    for (int i = 0; i < warm; i++) {
+      pg->allreduce(tensors)->wait();
+    }
+    pg->barrier()->wait();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) {
+      pg->allreduce(tensors)->wait();
+    }
+    std::chrono::duration<double, std::micro> span = std::chrono::steady_clock::now() - start;
+    if (rank == 0) {
+      std::printf("%10ld bytes: %10.2f us\n", static_cast<long>(bytes), span.count() / iters);
+    }
+  }
+  return 0;
+}
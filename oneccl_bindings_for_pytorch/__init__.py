@@ -15,6 +15,17 @@ def set_env_default(env, key, value):
 
 from .version import __version__, git_version
 from . import _C as ccl_lib
+from .collectives import set_allgather_quantization, all_gather_into_tensor_quantized
+from .collectives import set_allreduce_fp32_accumulation, allreduce_
+from .collectives import broadcast_delta, reset_broadcast_delta
+from .collectives import allreduce_topk, TopKState, topk_allreduce_hook
+from .collectives import allgatherv, broadcast_with_size, all_gather_object, broadcast_object_list
+from .collectives import allreduce_partial, BoundedStaleness
+from .collectives import allreduce_custom, custom_reductions
+from .collectives import comm_handles, sendrecv, RingExchange
+from .allocator import empty_hugepage
+from .symmetric_memory import symmetric_empty, SymmetricMemory
+from .symmetric_memory import broadcast_node_shared, all_gather_into_tensor_node_shared
 
 if hasattr(torch, 'xpu'):
     try:
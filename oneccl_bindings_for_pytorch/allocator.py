@@ -0,0 +1,16 @@
+import torch
+
+from . import _C as ccl_lib
+
+
+def empty_hugepage(size, dtype=torch.float32, numa_node=-1):
+    """Uninitialized CPU tensor backed by huge pages, e.g. for gradient
+    buckets handed to the collectives. Explicit hugetlb pages are used when
+    reserved, transparent huge pages otherwise. A non-negative ``numa_node``
+    binds the memory to that node."""
+    if isinstance(size, int):
+        size = (size,)
+    size = torch.Size(size)
+    itemsize = torch.empty((), dtype=dtype).element_size()
+    buf = ccl_lib._empty_hugepage(size.numel() * itemsize, numa_node)
+    return buf.view(dtype).view(size)
@@ -0,0 +1,374 @@
+import pickle
+import time
+
+import torch
+import torch.distributed as dist
+
+from . import _C as ccl_lib
+
+
+def _get_ccl_backend(group=None, device="cpu"):
+    if group is None:
+        group = dist.distributed_c10d._get_default_group()
+    return group._get_backend(torch.device(device))
+
+
+def set_allgather_quantization(quant, block_size=256, group=None, min_bytes=1 << 20):
+    """Select the wire format used by ``all_gather_into_tensor`` on the CPU
+    backend of ``group``: "none", "int8" or "fp8". Each ``block_size``
+    elements of a shard share one fp32 scale. Shards smaller than
+    ``min_bytes`` are gathered exactly."""
+    _get_ccl_backend(group).set_allgather_quantization(quant, block_size, min_bytes)
+
+
+def set_allreduce_fp32_accumulation(enable, group=None):
+    """Let bf16/fp16 SUM allreduce on the CPU backend of ``group`` accumulate
+    in fp32 while the payload stays in the reduced precision type."""
+    _get_ccl_backend(group).allreduce_fp32_accumulation = enable
+
+
+def all_gather_into_tensor_quantized(output_tensor, input_tensor, quant="int8",
+                                     block_size=256, group=None, async_op=False):
+    """``all_gather_into_tensor`` with the shards quantized on the wire and
+    dequantized into the full precision ``output_tensor``."""
+    work = _get_ccl_backend(group, input_tensor.device)._allgather_base_quantized(
+        output_tensor, input_tensor, quant, block_size)
+    if async_op:
+        return work
+    work.wait()
+
+
+# Backends of allreduce_ by (group, device).
+_direct_backends = {}
+
+
+def allreduce_(tensor, op=dist.ReduceOp.SUM, group=None):
+    """In-place ``all_reduce`` of ``tensor`` which returns once it has
+    completed. It goes straight to the backend without the torch.distributed
+    wrappers, the c10d dispatcher, the profiler record and the work object,
+    which saves several microseconds per call in per layer tensor parallel
+    allreduces of decode loops. Use ``dist.all_reduce`` for async ops."""
+    key = (group, tensor.device)
+    entry = _direct_backends.get(key)
+    # The default group is looked up once, and again after it was replaced.
+    if entry is None or (group is None and entry[0] is not dist.GroupMember.WORLD):
+        entry = (dist.GroupMember.WORLD, _get_ccl_backend(group, tensor.device))
+        _direct_backends[key] = entry
+    entry[1]._allreduce_direct(tensor, int(op))
+
+
+def _group_rank(group, global_rank):
+    return global_rank if group is None else dist.get_group_rank(group, global_rank)
+
+
+def allgatherv(tensor, group=None, async_op=False):
+    """Gathers ``tensor`` from every rank of ``group``, where each rank may
+    pass a different number of elements, and returns the list of them. The
+    8-byte sizes are gathered first, then the payloads in one collective
+    without padding. With ``async_op`` it returns the work instead, whose
+    future holds the uint8 payloads back to back and the int64 byte size of
+    each rank's."""
+    flat = tensor.contiguous().view(-1)
+    work = _get_ccl_backend(group)._allgatherv(flat.view(torch.uint8))
+    if async_op:
+        return work
+    work.wait()
+    data, sizes = work.result()
+    return [chunk.view(tensor.dtype) for chunk in data.split(sizes.tolist())]
+
+
+def broadcast_with_size(tensor, src, group=None, async_op=False):
+    """Broadcasts the 1-D ``tensor`` of ``src`` to ranks which do not know
+    its size, and returns it. The other ranks pass an empty tensor of the
+    same dtype. With ``async_op`` it returns the work instead, whose future
+    holds the uint8 payload."""
+    work = _get_ccl_backend(group)._broadcast_with_size(tensor.contiguous().view(torch.uint8),
+                                                        _group_rank(group, src))
+    if async_op:
+        return work
+    work.wait()
+    return work.result()[0].view(tensor.dtype)
+
+
+def _object_to_tensor(obj):
+    return torch.frombuffer(bytearray(pickle.dumps(obj)), dtype=torch.uint8)
+
+
+def _tensor_to_object(tensor):
+    return pickle.loads(tensor.numpy().tobytes())
+
+
+def all_gather_object(object_list, obj, group=None):
+    """``dist.all_gather_object`` for the CPU backend with one ``allgatherv``,
+    whose payload allgather is not padded to the largest object."""
+    for i, chunk in enumerate(allgatherv(_object_to_tensor(obj), group)):
+        object_list[i] = _tensor_to_object(chunk)
+
+
+def broadcast_object_list(object_list, src=0, group=None):
+    """``dist.broadcast_object_list`` for the CPU backend with one
+    ``broadcast_with_size``, a single op instead of two blocking ones."""
+    if dist.get_rank() == src:
+        broadcast_with_size(_object_to_tensor(list(object_list)), src, group)
+    else:
+        object_list[:] = _tensor_to_object(broadcast_with_size(torch.empty(0, dtype=torch.uint8), src, group))
+
+
+def allreduce_topk(tensor, ratio=0.01, key=0, group=None, async_op=False):
+    """SUM ``all_reduce`` of a CPU gradient sparsified to its top ``ratio``
+    entries by magnitude, picked per chunk of 4096 elements. What a rank does
+    not send is kept in an fp32 residual owned by the process group under
+    ``key`` and added to the next gradient with the same key."""
+    work = _get_ccl_backend(group, tensor.device)._allreduce_topk(tensor, ratio, key)
+    if async_op:
+        return work
+    work.wait()
+
+
+class TopKState:
+    """State of ``topk_allreduce_hook``."""
+
+    def __init__(self, ratio=0.01, group=None):
+        self.ratio = ratio
+        self.group = group
+
+
+def topk_allreduce_hook(state, bucket):
+    """DDP communication hook averaging the gradients with ``allreduce_topk``,
+    keeping one residual per bucket::
+
+        model.register_comm_hook(TopKState(ratio=0.01), topk_allreduce_hook)
+    """
+    world_size = dist.get_world_size(state.group)
+    buffer = bucket.buffer()
+    fut = allreduce_topk(buffer, state.ratio, bucket.index(), state.group, async_op=True).get_future()
+    return fut.then(lambda fut: fut.value()[0].div_(world_size))
+
+
+def sendrecv(send_tensor, recv_tensor, dst, src, group=None, async_op=False):
+    """Sends ``send_tensor`` to rank ``dst`` while receiving ``recv_tensor``
+    from rank ``src``, as one op with a single work. Every rank of ``group``
+    has to call it. Ranks are global ranks as in ``dist.send``. CPU only."""
+    work = _get_ccl_backend(group, send_tensor.device).sendrecv(
+        send_tensor, recv_tensor, _group_rank(group, dst), _group_rank(group, src))
+    if async_op:
+        return work
+    work.wait()
+
+
+class RingExchange:
+    """Double buffered hop of a ring, e.g. the K/V blocks of ring attention.
+
+    ``start`` sends the current block to the next rank of ``group`` and
+    receives the previous rank's into the other buffer while the caller
+    computes on the current one. ``wait`` makes the received block current::
+
+        ring = RingExchange(kv)
+        for step in range(world_size):
+            if step + 1 < world_size:
+                ring.start()
+            attend(q, ring.current)
+            if step + 1 < world_size:
+                ring.wait()
+    """
+
+    def __init__(self, tensor, group=None):
+        self.group = group
+        rank = dist.get_rank(group)
+        size = dist.get_world_size(group)
+        ranks = dist.get_process_group_ranks(group) if group is not None else list(range(size))
+        self.dst = ranks[(rank + 1) % size]
+        self.src = ranks[(rank - 1) % size]
+        self._buffers = [tensor.detach().clone().contiguous(), torch.empty_like(tensor).contiguous()]
+        self._index = 0
+        self._work = None
+
+    @property
+    def current(self):
+        return self._buffers[self._index]
+
+    def start(self):
+        assert self._work is None, "RingExchange.start called twice without wait"
+        self._work = sendrecv(self._buffers[self._index], self._buffers[1 - self._index],
+                              self.dst, self.src, self.group, async_op=True)
+
+    def wait(self):
+        self._work.wait()
+        self._work = None
+        self._index = 1 - self._index
+        return self.current
+
+
+def comm_handles(group=None, device="cpu"):
+    """PyCapsule named "oneccl_bindings_for_pytorch.CommHandles" holding the
+    oneCCL communicator, stream and KVS which ``group`` uses on ``device``,
+    for C++ extensions issuing oneCCL ops themselves, see comm_handles.h. The
+    capsule keeps them alive. The first call on a device is collective."""
+    return _get_ccl_backend(group, device)._comm_handles(str(device))
+
+
+def allreduce_partial(tensor, contribute=True, key=0, group=None, async_op=False):
+    """SUM ``all_reduce`` of a CPU tensor to which only the ranks passing
+    ``contribute`` add their ``tensor``. Every rank still has to call it. A
+    rank which does not contribute keeps its ``tensor`` in an fp32 residual of
+    the process group under ``key`` and adds it to its next contribution with
+    the same key. Returns a bool tensor of the ranks which contributed, or the
+    work when ``async_op``, whose future holds ``[tensor, contributors]``."""
+    work = _get_ccl_backend(group, tensor.device)._allreduce_partial(tensor, contribute, key)
+    if async_op:
+        return work
+    work.wait()
+    return work.result()[1]
+
+
+def allreduce_custom(tensor, op, group=None, async_op=False):
+    """In-place ``all_reduce`` of a CPU tensor with the reduction registered
+    as ``op``, one of ``custom_reductions()``: the built-in "logsumexp",
+    "kahan_sum" and "max_with_index", or ones which C++ extensions added
+    through ``oneccl_bindings_for_pytorch::registerReduction``, see
+    custom_reduction.h. Reductions of pairs such as "max_with_index" take a
+    tensor whose last dimension holds the pair."""
+    work = _get_ccl_backend(group, tensor.device)._allreduce_custom(tensor, op)
+    if async_op:
+        return work
+    work.wait()
+
+
+def custom_reductions():
+    """Names accepted by ``allreduce_custom``."""
+    return ccl_lib.custom_reductions()
+
+
+class BoundedStaleness:
+    """Deadline for local SGD style steps averaged with ``allreduce_partial``.
+
+    A rank checks ``expired()`` between micro-batches and stops accumulating
+    once the step is ``deadline`` seconds old, so a straggler holds the others
+    back by at most the deadline. A rank which did not finish its share passes
+    ``complete=False`` and its partial gradient is folded into a later step,
+    at most ``max_staleness`` steps later::
+
+        state = BoundedStaleness(deadline=0.2, max_staleness=2)
+        state.start()
+        done = 0
+        for batch in micro_batches:
+            if state.expired():
+                break
+            model(batch).sum().backward()
+            done += 1
+        state.allreduce(grad, complete=done == len(micro_batches))
+    """
+
+    def __init__(self, deadline, max_staleness=4, group=None):
+        self.deadline = deadline
+        self.max_staleness = max_staleness
+        self.group = group
+        self._start = time.monotonic()
+        self._skipped = {}
+
+    def start(self):
+        self._start = time.monotonic()
+
+    def expired(self):
+        return time.monotonic() - self._start > self.deadline
+
+    def allreduce(self, tensor, complete=True, key=0):
+        """Averages ``tensor`` over the ranks which contribute and returns
+        their mask."""
+        skipped = self._skipped.get(key, 0)
+        contribute = complete or skipped >= self.max_staleness
+        contributors = allreduce_partial(tensor, contribute, key, self.group)
+        self._skipped[key] = 0 if contribute else skipped + 1
+        count = int(contributors.sum())
+        if count > 0:
+            tensor.div_(count)
+        return contributors
+
+    def reset(self):
+        self._skipped.clear()
+        _get_ccl_backend(self.group).clear_partial_residuals()
+
+
+# broadcast_delta state per (group, key). The root keeps what it needs to
+# find the changed blocks, receivers only the version they hold.
+_delta_broadcast_state = {}
+
+
+def broadcast_delta(tensor, src, group=None, key=None, block_bytes=64 * 1024, xor=False):
+    """Stateful ``broadcast`` for a CPU tensor which is sent over and over while
+    changing little, e.g. weights pushed from trainer to inference ranks.
+
+    The first call sends the whole tensor. Later calls with the same ``key``,
+    by default the tensor's data pointer, only send the blocks of
+    ``block_bytes`` which changed since the last call and the receivers patch
+    them into ``tensor`` in place. The root finds the changed blocks by
+    hashing them; with ``xor`` it keeps a copy of the last version instead,
+    compares exactly and sends the changed blocks XORed with it and sparse
+    encoded, which pays off when only some elements of a block change.
+    Receivers must not modify ``tensor`` between two calls."""
+    if not tensor.is_contiguous() or tensor.device.type != "cpu":
+        raise ValueError("broadcast_delta expects a contiguous CPU tensor")
+    state_key = (group, tensor.data_ptr() if key is None else key)
+    state = _delta_broadcast_state.get(state_key)
+    nbytes = tensor.numel() * tensor.element_size()
+
+    # [version, nbytes, block_bytes, full, changed blocks, payload bytes, encoded bytes]
+    if dist.get_rank() == src:
+        full = (state is None or state["nbytes"] != nbytes or
+                state["block_bytes"] != block_bytes or state["xor"] != xor)
+        encoded = None
+        if full:
+            state = {"version": 0, "nbytes": nbytes, "block_bytes": block_bytes, "xor": xor}
+            blocks = torch.arange((nbytes + block_bytes - 1) // block_bytes, dtype=torch.long)
+            payload = ccl_lib._delta_gather_blocks(tensor, blocks, block_bytes)
+            if xor:
+                state["base"] = tensor.clone()
+            else:
+                state["hashes"] = ccl_lib._delta_block_hashes(tensor, block_bytes)
+        elif xor:
+            blocks = ccl_lib._delta_changed_blocks(tensor, state["base"], block_bytes)
+            payload = ccl_lib._delta_gather_blocks(tensor, blocks, block_bytes, state["base"])
+            if blocks.numel() > 0:
+                encoded = ccl_lib._sparse_encode(payload.view(tensor.dtype))
+        else:
+            hashes = ccl_lib._delta_block_hashes(tensor, block_bytes)
+            blocks = (hashes != state["hashes"]).nonzero().view(-1)
+            payload = ccl_lib._delta_gather_blocks(tensor, blocks, block_bytes)
+            state["hashes"] = hashes
+        state["version"] += 1
+        _delta_broadcast_state[state_key] = state
+        data = payload if encoded is None else encoded
+        header = torch.tensor([state["version"], nbytes, block_bytes, int(full), blocks.numel(),
+                               payload.numel(), 0 if encoded is None else encoded.numel()], dtype=torch.long)
+        dist.broadcast(header, src, group)
+        if blocks.numel() > 0:
+            dist.broadcast(blocks, src, group)
+            dist.broadcast(data, src, group)
+        return
+
+    header = torch.empty(7, dtype=torch.long)
+    dist.broadcast(header, src, group)
+    version, root_nbytes, root_block_bytes, full, nblocks, payload_bytes, encoded_bytes = header.tolist()
+    # Take part in every broadcast of the root before checking anything.
+    blocks = torch.empty(nblocks, dtype=torch.long)
+    data = torch.empty(encoded_bytes or payload_bytes, dtype=torch.uint8)
+    if nblocks > 0:
+        dist.broadcast(blocks, src, group)
+        dist.broadcast(data, src, group)
+    if root_nbytes != nbytes:
+        raise RuntimeError("broadcast_delta: the root sends {} bytes into a tensor of {} bytes".format(
+            root_nbytes, nbytes))
+    if not full and (state is None or state["version"] != version - 1):
+        raise RuntimeError("broadcast_delta: the root sent a delta against version {}, this rank holds {}".format(
+            version - 1, None if state is None else state["version"]))
+    payload = data
+    if encoded_bytes:
+        payload = torch.empty(payload_bytes, dtype=torch.uint8)
+        ccl_lib._sparse_decode(data, payload.view(tensor.dtype))
+    ccl_lib._delta_scatter_blocks(tensor, blocks, payload, root_block_bytes, encoded_bytes > 0)
+    _delta_broadcast_state[state_key] = {"version": version}
+
+
+def reset_broadcast_delta():
+    """Drop the state of ``broadcast_delta``, the next call sends everything."""
+    _delta_broadcast_state.clear()
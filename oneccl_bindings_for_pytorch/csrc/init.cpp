@@ -60,6 +60,10 @@
 #endif
 
 #include <ProcessGroupCCL.hpp>
+#include <hugepage_allocator.h>
+#include <delta_sync.h>
+#include <custom_reduction.h>
+#include <symmetric_memory.h>
 
 namespace py = pybind11;
 
@@ -129,17 +133,46 @@ TORCH_CCL_CPP_API void torch_ccl_python_init(pybind11::module &m) {
   #else 
   auto backend = module.attr("ProcessGroup");
   #endif
-  register_backend("ccl", py::cpp_function(&c10d::ProcessGroupCCL::createProcessGroupCCL,
-                                           py::arg("store"),
-                                           py::arg("rank"),
-                                           py::arg("size"),
-                                           py::arg("timeout") = std::chrono::milliseconds(
-                                                   ::c10d::ProcessGroupCCL::OP_TIMEOUT_MILLIS)),
-		                           false, std::vector<std::string>{"xpu", "cpu"});
+  // Registered with the extended API so that the pg_options of
+  // init_process_group/new_group reach the backend.
+  register_backend("ccl", py::cpp_function(
+                              [](const py::object& dist_backend_opts, const py::object& pg_options) {
+                                auto store = dist_backend_opts.attr("store").cast<c10::intrusive_ptr<::c10d::Store>>();
+                                auto rank = dist_backend_opts.attr("group_rank").cast<int>();
+                                auto size = dist_backend_opts.attr("group_size").cast<int>();
+                                auto timeout = dist_backend_opts.attr("timeout").cast<std::chrono::milliseconds>();
+                                auto options = pg_options.is_none()
+                                    ? ::c10d::ProcessGroupCCL::Options::create(timeout)
+                                    : pg_options.cast<c10::intrusive_ptr<::c10d::ProcessGroupCCL::Options>>();
+                                return c10d::ProcessGroupCCL::createProcessGroupCCL(store, rank, size, timeout, options);
+                              },
+                              py::arg("dist_backend_opts"),
+                              py::arg("pg_options")),
+		                           true, std::vector<std::string>{"xpu", "cpu"});
   
   auto processGroupCCL = intrusive_ptr_no_gil_destructor_class_<::c10d::ProcessGroupCCL>(
           module, "ProcessGroupCCL", backend);
 
+  py::class_<::c10d::ProcessGroupCCL::Options, c10::intrusive_ptr<::c10d::ProcessGroupCCL::Options>>(
+          processGroupCCL, "Options", backend.attr("Options"))
+      .def(py::init<std::chrono::milliseconds>(),
+           py::arg("timeout") = ::c10d::kProcessGroupDefaultTimeout)
+      .def_readwrite("blocking_wait", &::c10d::ProcessGroupCCL::Options::blocking_wait)
+      .def_readwrite("same_stream", &::c10d::ProcessGroupCCL::Options::same_stream)
+      .def_readwrite("priority", &::c10d::ProcessGroupCCL::Options::priority)
+      .def_readwrite("allgather_quant", &::c10d::ProcessGroupCCL::Options::allgather_quant)
+      .def_readwrite("allgather_quant_block", &::c10d::ProcessGroupCCL::Options::allgather_quant_block)
+      .def_readwrite("allgather_quant_min_bytes", &::c10d::ProcessGroupCCL::Options::allgather_quant_min_bytes)
+      .def_readwrite("allreduce_fp32_accum", &::c10d::ProcessGroupCCL::Options::allreduce_fp32_accum)
+      .def_readwrite("callback_threads", &::c10d::ProcessGroupCCL::Options::callback_threads)
+      .def_readwrite("async_submit", &::c10d::ProcessGroupCCL::Options::async_submit)
+      .def_readwrite("sparse_comm", &::c10d::ProcessGroupCCL::Options::sparse_comm)
+      .def_readwrite("batch_allreduce", &::c10d::ProcessGroupCCL::Options::batch_allreduce)
+      .def_readwrite("batch_max_ops", &::c10d::ProcessGroupCCL::Options::batch_max_ops)
+      .def_readwrite("batch_max_bytes", &::c10d::ProcessGroupCCL::Options::batch_max_bytes)
+      .def_readwrite("max_in_flight", &::c10d::ProcessGroupCCL::Options::max_in_flight)
+      .def_readwrite("llm_allreduce", &::c10d::ProcessGroupCCL::Options::llm_allreduce);
+
   processGroupCCL.def(
     py::init([](const c10::intrusive_ptr<::c10d::Store>& store,
                 int rank,
@@ -152,4 +185,227 @@ TORCH_CCL_CPP_API void torch_ccl_python_init(pybind11::module &m) {
     py::arg("size"),
     py::arg("timeout") = std::chrono::milliseconds(10 * 1000));
 
+  processGroupCCL.def(
+    py::init([](const c10::intrusive_ptr<::c10d::Store>& store,
+                int rank,
+                int size,
+                c10::intrusive_ptr<::c10d::ProcessGroupCCL::Options> options) {
+      return c10::make_intrusive<::c10d::ProcessGroupCCL>(store, rank, size, options->timeout, options);
+    }),
+    py::arg("store"),
+    py::arg("rank"),
+    py::arg("size"),
+    py::arg("options"));
+
+  processGroupCCL.def_property_readonly("options", &::c10d::ProcessGroupCCL::getOptions);
+
+  processGroupCCL.def("callback_stats", &::c10d::ProcessGroupCCL::getCallbackStats);
+
+  processGroupCCL.def(
+    "_comm_handles",
+    [](::c10d::ProcessGroupCCL& self, const std::string& device) {
+      void* handles;
+      {
+        // The first call creates the communicator, which waits for the other ranks.
+        py::gil_scoped_release release;
+        handles = self.newCommHandles(at::Device(device));
+      }
+      // The name is kCommHandlesCapsuleName of comm_handles.h.
+      return py::capsule(handles, "oneccl_bindings_for_pytorch.CommHandles",
+                         [](PyObject* capsule) {
+                           ::c10d::ProcessGroupCCL::deleteCommHandles(
+                               PyCapsule_GetPointer(capsule, "oneccl_bindings_for_pytorch.CommHandles"));
+                         });
+    },
+    py::arg("device") = "cpu");
+  processGroupCCL.def("dump_in_flight", &::c10d::ProcessGroupCCL::dumpInFlightOps);
+
+  processGroupCCL.def(
+    "_allgather_base_quantized",
+    &::c10d::ProcessGroupCCL::_allgather_base_quantized,
+    py::arg("output"),
+    py::arg("input"),
+    py::arg("quant") = "int8",
+    py::arg("block_size") = oneccl_bindings_for_pytorch::kDefaultQuantBlockSize,
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "_allreduce_topk",
+    &::c10d::ProcessGroupCCL::_allreduce_topk,
+    py::arg("tensor"),
+    py::arg("ratio"),
+    py::arg("key") = 0,
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def("clear_topk_residuals", &::c10d::ProcessGroupCCL::clearTopKResiduals);
+
+  processGroupCCL.def(
+    "_allreduce_partial",
+    &::c10d::ProcessGroupCCL::_allreduce_partial,
+    py::arg("tensor"),
+    py::arg("contribute"),
+    py::arg("key") = 0,
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def("clear_partial_residuals", &::c10d::ProcessGroupCCL::clearPartialResiduals);
+
+  processGroupCCL.def(
+    "_allreduce_custom",
+    &::c10d::ProcessGroupCCL::_allreduce_custom,
+    py::arg("tensor"),
+    py::arg("reduction"),
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "_allgatherv",
+    &::c10d::ProcessGroupCCL::allgatherv,
+    py::arg("input"),
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "_broadcast_with_size",
+    &::c10d::ProcessGroupCCL::broadcastWithSize,
+    py::arg("input"),
+    py::arg("root"),
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "sendrecv",
+    &::c10d::ProcessGroupCCL::sendrecv,
+    py::arg("send_tensor"),
+    py::arg("recv_tensor"),
+    py::arg("dst"),
+    py::arg("src"),
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "_allreduce_direct",
+    [](::c10d::ProcessGroupCCL& self, at::Tensor& tensor, int64_t op) {
+      ::c10d::AllreduceOptions opts;
+      opts.reduceOp = ::c10d::ReduceOp(static_cast<::c10d::ReduceOp::RedOpType>(op));
+      self.allreduceDirect(tensor, opts);
+    },
+    py::arg("tensor"),
+    py::arg("op"),
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "flush_batched_allreduces",
+    &::c10d::ProcessGroupCCL::flushBatchedAllreduces,
+    py::call_guard<py::gil_scoped_release>());
+
+  processGroupCCL.def(
+    "set_allgather_quantization",
+    &::c10d::ProcessGroupCCL::setAllgatherQuantization,
+    py::arg("quant"),
+    py::arg("block_size") = oneccl_bindings_for_pytorch::kDefaultQuantBlockSize,
+    py::arg("min_bytes") = oneccl_bindings_for_pytorch::kDefaultQuantMinBytes);
+
+  processGroupCCL.def_readwrite(
+    "allreduce_fp32_accumulation",
+    &::c10d::ProcessGroupCCL::allreduce_fp32_accum_);
+
+  processGroupCCL.def_readwrite(
+    "sparse_comm",
+    &::c10d::ProcessGroupCCL::sparse_comm_);
+
+  m.def(
+    "_empty_hugepage",
+    &oneccl_bindings_for_pytorch::emptyHugePageBytes,
+    py::arg("nbytes"),
+    py::arg("numa_node") = -1);
+
+  m.def(
+    "_sparse_encode",
+    [](const at::Tensor& input) {
+      auto encoded = at::empty({oneccl_bindings_for_pytorch::sparseEncodedBound(input.numel(), input.element_size())},
+                               input.options().dtype(at::kByte));
+      int64_t bytes = oneccl_bindings_for_pytorch::sparseEncode(input, encoded);
+      return encoded.narrow(0, 0, bytes);
+    },
+    py::arg("input"),
+    py::call_guard<py::gil_scoped_release>());
+
+  m.def(
+    "_sparse_decode",
+    [](const at::Tensor& encoded, at::Tensor& output) {
+      oneccl_bindings_for_pytorch::sparseDecode(encoded, output);
+    },
+    py::arg("encoded"),
+    py::arg("output"),
+    py::call_guard<py::gil_scoped_release>());
+
+  m.def("custom_reductions", &oneccl_bindings_for_pytorch::reductionNames);
+
+  m.def(
+    "_symmetric_map",
+    &oneccl_bindings_for_pytorch::mapSymmetricRegion,
+    py::arg("name"),
+    py::arg("nbytes"),
+    py::arg("create"));
+
+  m.def(
+    "_symmetric_protect",
+    &oneccl_bindings_for_pytorch::protectSymmetricRegion,
+    py::arg("view"));
+
+  m.def(
+    "_symmetric_unlink",
+    &oneccl_bindings_for_pytorch::unlinkSymmetricRegion,
+    py::arg("name"));
+
+  m.def(
+    "_symmetric_signal",
+    &oneccl_bindings_for_pytorch::symmetricSignal,
+    py::arg("flags"),
+    py::arg("index"),
+    py::arg("value"));
+
+  m.def(
+    "_symmetric_wait",
+    &oneccl_bindings_for_pytorch::symmetricWait,
+    py::arg("flags"),
+    py::arg("index"),
+    py::arg("value"),
+    py::arg("timeout") = -1.0,
+    py::call_guard<py::gil_scoped_release>());
+
+  m.def(
+    "_delta_block_hashes",
+    &oneccl_bindings_for_pytorch::deltaBlockHashes,
+    py::arg("tensor"),
+    py::arg("block_bytes"),
+    py::call_guard<py::gil_scoped_release>());
+
+  m.def(
+    "_delta_changed_blocks",
+    &oneccl_bindings_for_pytorch::deltaChangedBlocks,
+    py::arg("tensor"),
+    py::arg("base"),
+    py::arg("block_bytes"),
+    py::call_guard<py::gil_scoped_release>());
+
+  m.def(
+    "_delta_gather_blocks",
+    [](const at::Tensor& tensor, const at::Tensor& blocks, int64_t block_bytes,
+       const c10::optional<at::Tensor>& base) {
+      return oneccl_bindings_for_pytorch::deltaGatherBlocks(tensor, blocks, block_bytes,
+                                                            base.value_or(at::Tensor()));
+    },
+    py::arg("tensor"),
+    py::arg("blocks"),
+    py::arg("block_bytes"),
+    py::arg("base") = py::none(),
+    py::call_guard<py::gil_scoped_release>());
+
+  m.def(
+    "_delta_scatter_blocks",
+    &oneccl_bindings_for_pytorch::deltaScatterBlocks,
+    py::arg("tensor"),
+    py::arg("blocks"),
+    py::arg("payload"),
+    py::arg("block_bytes"),
+    py::arg("xor_payload"),
+    py::call_guard<py::gil_scoped_release>());
+
 }
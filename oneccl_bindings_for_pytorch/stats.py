@@ -0,0 +1,166 @@
+"""Reader for the communication stats published with TORCH_CCL_STATS_SHM=1.
+
+Every process group of a rank maps /dev/shm/torch_ccl_stats.<pid>.<group>
+and updates it under a seqlock, so this module only needs the standard
+library and can watch a running job from another shell:
+
+    python -m oneccl_bindings_for_pytorch.stats --watch 1
+"""
+import argparse
+import glob
+import os
+import struct
+import sys
+import time
+
+STATS_GLOB = "/dev/shm/torch_ccl_stats.*"
+MAGIC = 0x5441545354434354
+VERSION = 1
+OP_SLOTS = 32
+LATENCY_BUCKETS = 32
+
+# Must match CommStatsLayout in src/comm_stats.h.
+_HEADER = struct.Struct("<QQQqqqqQQQQQQ")
+_LAYOUT = struct.Struct("<QQQqqqqQQQQQQ" + "Q" * (2 * OP_SLOTS + LATENCY_BUCKETS))
+_HEADER_FIELDS = ("magic", "version", "seq", "rank", "size", "pid", "group_index", "issued",
+                  "completed", "errors", "in_flight", "last_completed_seq", "update_time_ns")
+
+# Slot order of c10d::OpType.
+OP_NAMES = ("broadcast", "allreduce", "allreduce_coalesced", "reduce", "allgather",
+            "_allgather_base", "allgather_coalesced", "gather", "scatter", "reduce_scatter",
+            "alltoall_base", "alltoall", "send", "recv", "recvanysource", "barrier",
+            "_reduce_scatter_base", "coalesced", "_allreduce_sparse")
+
+
+def _op_name(slot):
+    if slot < len(OP_NAMES):
+        return OP_NAMES[slot]
+    return "other" if slot == OP_SLOTS - 1 else "op{}".format(slot)
+
+
+def _pid_alive(pid):
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    except PermissionError:
+        pass
+    return True
+
+
+def read_stats(path, retries=100):
+    """Consistent snapshot of one stats file as a dict, None if the file is
+    stale, foreign or kept changing for all ``retries`` attempts."""
+    try:
+        with open(path, "rb") as f:
+            for _ in range(retries):
+                f.seek(0)
+                data = f.read(_LAYOUT.size)
+                if len(data) < _LAYOUT.size:
+                    return None
+                f.seek(0)
+                seq_after = _HEADER.unpack(f.read(_HEADER.size))[2]
+                values = _LAYOUT.unpack(data)
+                seq = values[2]
+                if seq % 2 == 1 or seq != seq_after:
+                    continue
+                stats = dict(zip(_HEADER_FIELDS, values[:len(_HEADER_FIELDS)]))
+                if stats["magic"] != MAGIC or stats["version"] != VERSION:
+                    return None
+                rest = values[len(_HEADER_FIELDS):]
+                stats["ops"] = list(rest[:OP_SLOTS])
+                stats["bytes"] = list(rest[OP_SLOTS:2 * OP_SLOTS])
+                stats["latency_us_hist"] = list(rest[2 * OP_SLOTS:])
+                stats["path"] = path
+                return stats
+    except OSError:
+        return None
+    return None
+
+
+def collect(pattern=STATS_GLOB, include_dead=False):
+    """Snapshots of all stats files on this node, ordered by rank and group."""
+    snapshots = []
+    for path in glob.glob(pattern):
+        stats = read_stats(path)
+        if stats is None:
+            continue
+        if not include_dead and not _pid_alive(stats["pid"]):
+            continue
+        snapshots.append(stats)
+    snapshots.sort(key=lambda s: (s["rank"], s["group_index"], s["pid"]))
+    return snapshots
+
+
+def latency_percentile(hist, q):
+    """Upper bound in microseconds of the log2 bucket holding quantile ``q``."""
+    total = sum(hist)
+    if total == 0:
+        return 0
+    target = q * total
+    seen = 0
+    for bucket, count in enumerate(hist):
+        seen += count
+        if seen >= target:
+            return 1 << (bucket + 1)
+    return 1 << len(hist)
+
+
+def _format_bytes(n):
+    for unit in ("B", "KB", "MB", "GB"):
+        if n < 1024:
+            return "{:.1f}{}".format(n, unit)
+        n /= 1024.0
+    return "{:.1f}TB".format(n)
+
+
+def format_report(snapshots, previous=None, interval=None):
+    lines = ["{:>4} {:>5} {:>4} {:>8} {:>10} {:>10} {:>8} {:>6} {:>9} {:>9} {:>9} {:>10}  {}".format(
+        "rank", "size", "pg", "pid", "issued", "completed", "inflight", "errors",
+        "p50(us)", "p90(us)", "p99(us)", "ops/s", "bytes by op")]
+    prev = {(s["pid"], s["group_index"]): s for s in (previous or [])}
+    for s in snapshots:
+        hist = s["latency_us_hist"]
+        rate = ""
+        old = prev.get((s["pid"], s["group_index"]))
+        if old is not None and interval:
+            rate = "{:.1f}".format((s["completed"] - old["completed"]) / interval)
+        per_op = ", ".join("{}={}/{}".format(_op_name(slot), s["ops"][slot], _format_bytes(s["bytes"][slot]))
+                           for slot in range(OP_SLOTS) if s["ops"][slot])
+        lines.append("{:>4} {:>5} {:>4} {:>8} {:>10} {:>10} {:>8} {:>6} {:>9} {:>9} {:>9} {:>10}  {}".format(
+            s["rank"], s["size"], s["group_index"], s["pid"], s["issued"], s["completed"],
+            s["in_flight"], s["errors"], latency_percentile(hist, 0.5), latency_percentile(hist, 0.9),
+            latency_percentile(hist, 0.99), rate, per_op))
+    if snapshots:
+        # Ranks that fall behind the rest of the node are the usual sign of a
+        # straggler or a hang.
+        issued = [s["issued"] for s in snapshots]
+        lines.append("node: {} groups, {} in flight, {} errors, issued spread {}".format(
+            len(snapshots), sum(s["in_flight"] for s in snapshots),
+            sum(s["errors"] for s in snapshots), max(issued) - min(issued)))
+    else:
+        lines.append("no stats files match {} (is TORCH_CCL_STATS_SHM=1 set?)".format(STATS_GLOB))
+    return "\n".join(lines)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Show the live communication stats of the local ranks")
+    parser.add_argument("--pattern", default=STATS_GLOB, help="glob of the stats files")
+    parser.add_argument("--watch", type=float, default=0, help="refresh every WATCH seconds")
+    parser.add_argument("--all", action="store_true", help="include files of exited processes")
+    args = parser.parse_args(argv)
+
+    previous = None
+    while True:
+        snapshots = collect(args.pattern, args.all)
+        if args.watch:
+            sys.stdout.write("\033[H\033[J")
+        print(format_report(snapshots, previous, args.watch))
+        if not args.watch:
+            return 0
+        previous = snapshots
+        time.sleep(args.watch)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
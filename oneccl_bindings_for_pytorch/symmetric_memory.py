@@ -0,0 +1,236 @@
+import os
+import socket
+
+import torch
+import torch.distributed as dist
+
+from . import _C as ccl_lib
+from .collectives import all_gather_object, _group_rank
+
+_PAGE = 4096
+# One int64 flag per cache line.
+_FLAG_STRIDE = 8
+
+# Regions created by this process, which make the names unique per leader.
+_region_seq = 0
+
+
+def _round_up(n, align):
+    return (n + align - 1) // align * align
+
+
+def _map_node_region(name, nbytes, leader, barrier):
+    # The leader creates the zero filled region, the other local ranks map it
+    # once it exists and the leader unlinks it once everyone mapped it.
+    region = ccl_lib._symmetric_map(name, nbytes, True) if leader else None
+    barrier()
+    if not leader:
+        region = ccl_lib._symmetric_map(name, nbytes, False)
+    barrier()
+    if leader:
+        ccl_lib._symmetric_unlink(name)
+    return region
+
+
+class SymmetricMemory:
+    """Buffers of the local ranks of a group in one shared memory region,
+    returned by ``symmetric_empty``. ``tensor`` is this rank's buffer and
+    ``peers[i]`` the buffer of local rank ``i``, all of them mapped in every
+    local rank, at the same offset of the region. ``ranks`` are the group
+    ranks of the local ranks.
+
+    ``signal(peer)`` tells ``peer`` that this rank's writes so far are done,
+    the matching ``wait(peer)`` blocks until ``peer`` signaled as often as
+    this rank waited for it. ``barrier()`` does both with every local rank."""
+
+    def __init__(self, region, shape, dtype, ranks, local_rank):
+        self.ranks = ranks
+        self.local_rank = local_rank
+        self.local_size = len(ranks)
+        itemsize = torch.empty((), dtype=dtype).element_size()
+        nbytes = torch.Size(shape).numel() * itemsize
+        header = _round_up(self.local_size * self.local_size * _FLAG_STRIDE * 8, _PAGE)
+        stride = _round_up(max(nbytes, 1), _PAGE)
+        self._region = region
+        self._flags = region[:header].view(torch.int64)
+        self.peers = [region[header + i * stride:header + i * stride + nbytes].view(dtype).view(shape)
+                      for i in range(self.local_size)]
+        self.tensor = self.peers[local_rank]
+        self._signaled = [0] * self.local_size
+        self._waited = [0] * self.local_size
+
+    def _flag(self, dst, src):
+        # Written by src only, read by dst.
+        return (dst * self.local_size + src) * _FLAG_STRIDE
+
+    def signal(self, peer):
+        self._signaled[peer] += 1
+        ccl_lib._symmetric_signal(self._flags, self._flag(peer, self.local_rank), self._signaled[peer])
+
+    def wait(self, peer, timeout=-1.0):
+        self._waited[peer] += 1
+        ccl_lib._symmetric_wait(self._flags, self._flag(self.local_rank, peer), self._waited[peer], timeout)
+
+    def barrier(self, timeout=-1.0):
+        for peer in range(self.local_size):
+            if peer != self.local_rank:
+                self.signal(peer)
+        for peer in range(self.local_size):
+            if peer != self.local_rank:
+                self.wait(peer, timeout)
+
+
+def symmetric_empty(shape, dtype=torch.float32, group=None):
+    """Uninitialized CPU tensor of ``shape`` for every rank of ``group``, in
+    POSIX shared memory shared by the ranks on the same node, e.g. for one
+    shot intra-node collectives written in Python or C++. Returns a
+    ``SymmetricMemory`` with this rank's ``tensor`` and its ``peers``'
+    views. Collective over ``group``, whose ranks have to make the same
+    calls in the same order. The memory goes away with the last view."""
+    if isinstance(shape, int):
+        shape = (shape,)
+    global _region_seq
+    rank = dist.get_rank(group)
+    infos = [None] * dist.get_world_size(group)
+    all_gather_object(infos, (socket.gethostname(), os.getpid(), _region_seq), group=group)
+    _region_seq += 1
+    ranks = [r for r, info in enumerate(infos) if info[0] == infos[rank][0]]
+    local_rank = ranks.index(rank)
+    leader = ranks[0]
+
+    name = "/oneccl_symm_{}_{}".format(infos[leader][1], infos[leader][2])
+    local_size = len(ranks)
+    itemsize = torch.empty((), dtype=dtype).element_size()
+    nbytes = (_round_up(local_size * local_size * _FLAG_STRIDE * 8, _PAGE) +
+              local_size * _round_up(max(torch.Size(shape).numel() * itemsize, 1), _PAGE))
+
+    region = _map_node_region(name, nbytes, rank == leader, lambda: dist.barrier(group))
+    return SymmetricMemory(region, shape, dtype, ranks, local_rank)
+
+
+class _NodeTopology:
+    # Ranks of a group grouped by node, with a group of this node's ranks and,
+    # on the node leaders, a group of the leaders.
+
+    def __init__(self, group):
+        global _region_seq
+        rank = dist.get_rank(group)
+        infos = [None] * dist.get_world_size(group)
+        all_gather_object(infos, (socket.gethostname(), os.getpid(), _region_seq), group=group)
+        _region_seq += 1
+        nodes = {}
+        for r, info in enumerate(infos):
+            nodes.setdefault(info[0], []).append(r)
+        self.nodes = sorted(nodes.values())
+        self.ranks = nodes[infos[rank][0]]
+        self.local_rank = self.ranks.index(rank)
+        self.is_leader = self.local_rank == 0
+        leader = infos[self.ranks[0]]
+        self.tag = "{}_{}".format(leader[1], leader[2])
+        self.seq = 0
+
+        def to_global(r):
+            return r if group is None else dist.get_global_rank(group, r)
+        self.local_group = dist.new_group([to_global(r) for r in self.ranks], use_local_synchronization=True)
+        self.leader_group = None
+        if self.is_leader and len(self.nodes) > 1:
+            self.leaders = [to_global(node[0]) for node in self.nodes]
+            self.leader_group = dist.new_group(self.leaders, use_local_synchronization=True)
+
+    def output(self, nbytes):
+        # Region of one flag per local rank, a ready flag set by the leader
+        # and the `nbytes` output, which ends the region.
+        header = _round_up((len(self.ranks) + 1) * _FLAG_STRIDE * 8, _PAGE)
+        name = "/oneccl_node_{}_{}".format(self.tag, self.seq)
+        self.seq += 1
+        region = _map_node_region(name, header + _round_up(max(nbytes, 1), _PAGE), self.is_leader,
+                                  lambda: dist.barrier(self.local_group))
+        return region[:header].view(torch.int64), region[header:header + nbytes]
+
+    def publish(self, flags, data):
+        # Leader: the output is complete. Others: wait for it. Then nobody
+        # writes it any more.
+        if self.is_leader:
+            ccl_lib._symmetric_signal(flags, 0, 1)
+        else:
+            ccl_lib._symmetric_wait(flags, 0, 1)
+        if data.numel() > 0:
+            ccl_lib._symmetric_protect(data)
+
+
+_topologies = {}
+
+
+def _node_topology(group):
+    key = group if group is not None else dist.distributed_c10d._get_default_group()
+    if key not in _topologies:
+        _topologies[key] = _NodeTopology(group)
+    return _topologies[key]
+
+
+def broadcast_node_shared(tensor, src, group=None):
+    """``dist.broadcast`` of the CPU ``tensor`` of global rank ``src`` into
+    one read only copy per node, in shared memory mapped by all the ranks of
+    ``group`` on the node, e.g. for weights loaded by one rank of a tensor
+    parallel inference job. Only one rank per node receives it over the
+    network. On ranks other than ``src`` only the shape and dtype of
+    ``tensor`` are used, so a tensor on the meta device will do. Returns the
+    shared tensor, which is freed with the last rank's reference."""
+    topo = _node_topology(group)
+    rank = dist.get_rank(group)
+    src = _group_rank(group, src)
+    nbytes = tensor.numel() * tensor.element_size()
+    flags, data = topo.output(nbytes)
+    out = data.view(tensor.dtype).view(tensor.shape)
+
+    if rank == src:
+        out.copy_(tensor)
+        if not topo.is_leader:
+            ccl_lib._symmetric_signal(flags, (1 + topo.local_rank) * _FLAG_STRIDE, 1)
+    if topo.is_leader:
+        src_node = next(i for i, node in enumerate(topo.nodes) if src in node)
+        if rank != src and src in topo.ranks:
+            ccl_lib._symmetric_wait(flags, (1 + topo.ranks.index(src)) * _FLAG_STRIDE, 1)
+        if topo.leader_group is not None and nbytes > 0:
+            dist.broadcast(data, topo.leaders[src_node], group=topo.leader_group)
+    topo.publish(flags, data)
+    return out
+
+
+def all_gather_into_tensor_node_shared(input_tensor, group=None):
+    """``dist.all_gather_into_tensor`` of CPU tensors into one read only
+    output per node, in shared memory mapped by all the ranks of ``group``
+    on the node, e.g. for KV blocks every tensor parallel rank reads. Each
+    rank writes its input into the output, then one rank per node exchanges
+    the node's inputs with the other nodes. Returns the output, the inputs
+    concatenated along the first dimension in rank order."""
+    topo = _node_topology(group)
+    rank = dist.get_rank(group)
+    size = dist.get_world_size(group)
+    nbytes = input_tensor.numel() * input_tensor.element_size()
+    flags, data = topo.output(nbytes * size)
+    slots = data.view(size, nbytes)
+    slots[rank].copy_(input_tensor.contiguous().view(-1).view(torch.uint8))
+    shape = input_tensor.shape
+    out = data.view(input_tensor.dtype).view((size * shape[0],) + shape[1:] if len(shape) else (size,))
+
+    if not topo.is_leader:
+        ccl_lib._symmetric_signal(flags, (1 + topo.local_rank) * _FLAG_STRIDE, 1)
+    else:
+        for i in range(1, len(topo.ranks)):
+            ccl_lib._symmetric_wait(flags, (1 + i) * _FLAG_STRIDE, 1)
+        if topo.leader_group is not None and nbytes > 0:
+            # The leaders exchange blocks of `most` slots. When the nodes hold
+            # equally many consecutive ranks the blocks land in place.
+            most = max(len(node) for node in topo.nodes)
+            block = torch.zeros(most, nbytes, dtype=torch.uint8)
+            block[:len(topo.ranks)] = slots[topo.ranks]
+            in_place = all(node == list(range(node[0], node[0] + most)) for node in topo.nodes)
+            gathered = slots if in_place else torch.empty(len(topo.nodes) * most, nbytes, dtype=torch.uint8)
+            dist.all_gather_into_tensor(gathered, block, group=topo.leader_group)
+            if not in_place:
+                for i, node in enumerate(topo.nodes):
+                    if node is not topo.ranks:
+                        slots[node] = gathered[i * most:i * most + len(node)]
+    topo.publish(flags, data)
+    return out
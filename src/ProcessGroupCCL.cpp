@@ -35,6 +35,7 @@
 #include <ATen/record_function.h>
 #include <ccl_comm_collector.h>
 #include "ProcessGroupCCL.hpp"
+#include "comm_handles.h"
 #include "dispatch_stub.h"
 #include "env.h"
 
@@ -508,6 +509,8 @@ TORCH_LIBRARY_IMPL(c10d, XPU, m) {
 using oneccl_bindings_for_pytorch::DispatchStub;
 using oneccl_bindings_for_pytorch::call_with_lock;
 using oneccl_bindings_for_pytorch::format_tensors_param;
+using oneccl_bindings_for_pytorch::isPremulSum;
+using oneccl_bindings_for_pytorch::premulFactor;
 
 namespace {
 
@@ -628,16 +631,99 @@ std::vector<at::Tensor> ProcessGroupCCL::AsyncWorkCCL::result() {
                                     : outputTensors_.at(0);
 }
 
+void ProcessGroupCCL::AsyncWorkCCL::recordCompletion(bool error) {
+  if (inFlightSlot_) {
+    inFlightSlot_->release();
+  }
+  if ((!commStats_ && !watchdog_) || completionRecorded_.exchange(true)) {
+    return;
+  }
+  if (commStats_) {
+    commStats_->recordCompletion(statsSeq_, issueTime_, error);
+  }
+  if (watchdog_) {
+    watchdog_->recordCompletion(watchdogSeq_);
+  }
+}
+
 void ProcessGroupCCL::AsyncWorkCCL::finishAsyncWorkCCLError(std::exception_ptr eptr) {
+  recordCompletion(true);
   future_->setError(eptr);
   finish(eptr);
 }
 
 void ProcessGroupCCL::AsyncWorkCCL::finishAsyncWorkCCL() {
+  if (postProcess_) {
+    postProcess_();
+  }
+  recordCompletion(false);
+  if (callbackExecutor_) {
+    // Leave the future and its callbacks to the executor so the progress
+    // thread can move on. The work is finished after the future is marked,
+    // so wait() never returns before getFuture() has a value.
+    auto self = c10::intrusive_ptr<AsyncWorkCCL>::unsafe_reclaim_from_nonowning(this);
+    callbackExecutor_->submit([self]() {
+      returnFutureWithOutput(self->future_, self->outputTensors_);
+      self->finish();
+    });
+    return;
+  }
   returnFutureWithOutput(future_, outputTensors_);
   finish();
 }
 
+void ProcessGroupCCL::AsyncWorkCCL::releaseResources() {
+  postProcess_ = nullptr;
+}
+
+ProcessGroupCCL::BatchedWorkCCL::BatchedWorkCCL(c10::weak_intrusive_ptr<ProcessGroupCCL> pg,
+                                                at::Tensor tensor,
+                                                int rank)
+        : C10D_Work(rank, c10d::OpType::ALLREDUCE),
+          pg_(pg),
+          tensor_(std::move(tensor)),
+          future_(createFutureAsOutput(std::vector<at::Tensor>{tensor_})) {}
+
+bool ProcessGroupCCL::BatchedWorkCCL::isCompleted() {
+  return future_->completed();
+}
+
+bool ProcessGroupCCL::BatchedWorkCCL::wait(std::chrono::milliseconds timeout) {
+  if (pending_.load()) {
+    if (auto pg = pg_.lock()) {
+      pg->flushBatchedAllreduces();
+    }
+  }
+  if (packed_) {
+    packed_->wait(timeout);
+  }
+  // The slice is copied back by a callback of the batch's future.
+  future_->wait();
+  return true;
+}
+
+c10::intrusive_ptr<c10::ivalue::Future> ProcessGroupCCL::BatchedWorkCCL::getFuture() {
+  return future_;
+}
+
+std::vector<at::Tensor> ProcessGroupCCL::BatchedWorkCCL::result() {
+  TORCH_CHECK(
+          isCompleted(),
+          "Work needs to be completed before calling result(). "
+          "Should call wait() before result().");
+  return {tensor_};
+}
+
+void ProcessGroupCCL::BatchedWorkCCL::complete(std::exception_ptr eptr) {
+  if (eptr) {
+    future_->setError(eptr);
+    finish(eptr);
+    return;
+  }
+  returnFutureWithOutput(future_, {{tensor_}});
+  finish();
+}
+
 const int64_t ProcessGroupCCL::OP_TIMEOUT_MILLIS = 10 * 1000;
 std::mutex ProcessGroupCCL::globalMutex;
 
@@ -664,47 +750,142 @@ c10::intrusive_ptr<ProcessGroup> ProcessGroupCCL::createProcessGroupCCL(
     const c10::intrusive_ptr<Store>& store,
     int rank,
     int size,
-    std::chrono::milliseconds op_time_out)
+    std::chrono::milliseconds op_time_out,
+    c10::intrusive_ptr<Options> options)
 {
-  return c10::make_intrusive<ProcessGroupCCL>(store, rank, size, op_time_out);
+  return c10::make_intrusive<ProcessGroupCCL>(store, rank, size, op_time_out, std::move(options));
 }
 
-ProcessGroupCCL::ProcessGroupCCL(const c10::intrusive_ptr<Store>& store, int rank, int size, std::chrono::milliseconds op_time_out)
+ProcessGroupCCL::Options::Options(std::chrono::milliseconds timeout)
+    : Baseclass::Options(CCL_BACKEND_NAME, timeout) {}
+
+ProcessGroupCCL::ProcessGroupCCL(const c10::intrusive_ptr<Store>& store,
+                                 int rank,
+                                 int size,
+                                 std::chrono::milliseconds op_time_out,
+                                 c10::intrusive_ptr<Options> options)
 #if TORCH_VERSION_MAJOR > 1
     : Backend(rank, size), store_(store), timeout(op_time_out),
 #else
     : ProcessGroup(rank, size), store_(store), timeout(op_time_out),
 #endif
-      ccl_member_(std::make_unique<oneccl_bindings_for_pytorch::CCLCommCollector>())
+      ccl_member_(std::make_unique<oneccl_bindings_for_pytorch::CCLCommCollector>()),
+      options_(std::move(options))
 {
   torch_llm_allreduce_ = parseTorchCCLEnvVarFlag(TORCH_LLM_ALLREDUCE, torch_llm_allreduce_);
-  // Hide CCL_SKIP_SCHEDULER/CCL_ENABLE_SYCL_KERNELS by TORCH_LLM_ALLREDUCE
-  if (torch_llm_allreduce_) {
+  // Hide CCL_SKIP_SCHEDULER/CCL_ENABLE_SYCL_KERNELS by TORCH_LLM_ALLREDUCE.
+  // They configure oneCCL for the whole process, so they are set once and
+  // only from the environment variable, never from a group's options.
+  static std::once_flag llmAllreduceEnvFlag;
+  std::call_once(llmAllreduceEnvFlag, [&]() {
+    if (torch_llm_allreduce_) {
       setOneCCLEnvVar("CCL_SKIP_SCHEDULER", 1); // for basekit 2024.1
       setOneCCLEnvVar("CCL_ENABLE_SYCL_KERNELS", 1); // for basekit 2024.2
+    }
+  });
+  if (options_->llm_allreduce.has_value()) {
+    torch_llm_allreduce_ = *options_->llm_allreduce;
+  }
+  if (torch_llm_allreduce_) {
       useSameStream_ = true;
       blockingWait_ = false;
   }
   useSameStream_ = parseTorchCCLEnvVarFlag(CCL_SAME_STREAM, useSameStream_);
   blockingWait_ = parseTorchCCLEnvVarFlag(CCL_BLOCKING_WAIT, blockingWait_);
 
+  if (char* quant = std::getenv(TORCH_CCL_ALLGATHER_QUANT)) {
+    allgather_quant_ = oneccl_bindings_for_pytorch::parseCommQuantType(quant);
+  }
+  int quant_block = getOneCCLEnvVar(TORCH_CCL_ALLGATHER_QUANT_BLOCK);
+  if (quant_block > 0) {
+    allgather_quant_block_ = quant_block;
+  }
+  int quant_min_bytes = getOneCCLEnvVar(TORCH_CCL_ALLGATHER_QUANT_MIN_BYTES);
+  if (quant_min_bytes >= 0) {
+    allgather_quant_min_bytes_ = quant_min_bytes;
+  }
+  allreduce_fp32_accum_ = parseTorchCCLEnvVarFlag(TORCH_CCL_ALLREDUCE_FP32_ACCUM, allreduce_fp32_accum_);
+  sparse_comm_ = parseTorchCCLEnvVarFlag(TORCH_CCL_SPARSE_COMM, sparse_comm_);
+  batch_allreduce_ = parseTorchCCLEnvVarFlag(TORCH_CCL_BATCH_ALLREDUCE, batch_allreduce_);
+  int batch_max_ops = getOneCCLEnvVar(TORCH_CCL_BATCH_MAX_OPS);
+  if (batch_max_ops > 0) {
+    batch_max_ops_ = batch_max_ops;
+  }
+  int batch_max_bytes = getOneCCLEnvVar(TORCH_CCL_BATCH_MAX_BYTES);
+  if (batch_max_bytes > 0) {
+    batch_max_bytes_ = batch_max_bytes;
+  }
+
+  // The group's options take precedence over the process wide environment.
+  if (options_->blocking_wait.has_value()) {
+    blockingWait_ = *options_->blocking_wait;
+  }
+  if (options_->same_stream.has_value()) {
+    useSameStream_ = *options_->same_stream;
+  }
+  if (options_->priority.has_value()) {
+    TORCH_CHECK(*options_->priority >= 0, "ProcessGroupCCL: priority must be non-negative");
+    op_priority_ = *options_->priority;
+  }
+  if (options_->allgather_quant.has_value() || options_->allgather_quant_block.has_value() ||
+      options_->allgather_quant_min_bytes.has_value()) {
+    setAllgatherQuantization(
+        options_->allgather_quant.value_or(oneccl_bindings_for_pytorch::commQuantTypeName(allgather_quant_)),
+        options_->allgather_quant_block.value_or(allgather_quant_block_),
+        options_->allgather_quant_min_bytes.value_or(allgather_quant_min_bytes_));
+  }
+  if (options_->allreduce_fp32_accum.has_value()) {
+    allreduce_fp32_accum_ = *options_->allreduce_fp32_accum;
+  }
+  if (options_->sparse_comm.has_value()) {
+    sparse_comm_ = *options_->sparse_comm;
+  }
+  if (options_->batch_allreduce.has_value()) {
+    batch_allreduce_ = *options_->batch_allreduce;
+  }
+  if (options_->batch_max_ops.has_value()) {
+    TORCH_CHECK(*options_->batch_max_ops > 0, "ProcessGroupCCL: batch_max_ops must be positive");
+    batch_max_ops_ = *options_->batch_max_ops;
+  }
+  if (options_->batch_max_bytes.has_value()) {
+    TORCH_CHECK(*options_->batch_max_bytes > 0, "ProcessGroupCCL: batch_max_bytes must be positive");
+    batch_max_bytes_ = *options_->batch_max_bytes;
+  }
+  int64_t max_in_flight = options_->max_in_flight.value_or(
+      std::max(getOneCCLEnvVar(TORCH_CCL_MAX_IN_FLIGHT), 0));
+  if (max_in_flight > 0) {
+    inFlightLimiter_ = std::make_shared<oneccl_bindings_for_pytorch::InFlightLimiter>(max_in_flight);
+  }
+  int64_t callback_threads = options_->callback_threads.value_or(
+      std::max(getOneCCLEnvVar(TORCH_CCL_CALLBACK_THREADS), 0));
+  if (callback_threads > 0) {
+    callbackExecutor_ = std::make_shared<oneccl_bindings_for_pytorch::CallbackExecutor>(callback_threads);
+  }
+  asyncSubmit_ = options_->async_submit.value_or(parseTorchCCLEnvVarFlag(TORCH_CCL_ASYNC_SUBMIT, asyncSubmit_));
+  commStats_ = oneccl_bindings_for_pytorch::CommStatsPublisher::create(rank, size);
+  watchdog_ = oneccl_bindings_for_pytorch::CommWatchdog::create(rank, size, timeout);
+
   // Set these 3 variables to follow oneCCL specs, which is required to enable use drmfd mode of ze exchange mechanism.
-  if (!with_mpirun()) {
-    // If it's launched by 'torchrun', LOCAL_RANK and LOCAL_WORLD_SIZE were set.
-    int local_rank = getOneCCLEnvVar("LOCAL_RANK");
-    int local_world_size = getOneCCLEnvVar("LOCAL_WORLD_SIZE");
-
-    // If these 2 variables were not set, it's launched by multi-processing package. In that case we'll
-    // use rank and size.
-    if (local_rank == -1 || local_world_size == -1) {
-        local_rank = rank;
-        local_world_size = size;
+  // They describe the process, so only the first group (the default one) sets them.
+  static std::once_flag launcherEnvFlag;
+  std::call_once(launcherEnvFlag, [&]() {
+    if (!with_mpirun()) {
+      // If it's launched by 'torchrun', LOCAL_RANK and LOCAL_WORLD_SIZE were set.
+      int local_rank = getOneCCLEnvVar("LOCAL_RANK");
+      int local_world_size = getOneCCLEnvVar("LOCAL_WORLD_SIZE");
+
+      // If these 2 variables were not set, it's launched by multi-processing package. In that case we'll
+      // use rank and size.
+      if (local_rank == -1 || local_world_size == -1) {
+          local_rank = rank;
+          local_world_size = size;
+      }
+
+      setOneCCLEnvVar("CCL_PROCESS_LAUNCHER", "none");
+      setOneCCLEnvVar("CCL_LOCAL_RANK", local_rank);
+      setOneCCLEnvVar("CCL_LOCAL_SIZE", local_world_size);
     }
-    
-    setOneCCLEnvVar("CCL_PROCESS_LAUNCHER", "none");
-    setOneCCLEnvVar("CCL_LOCAL_RANK", local_rank);
-    setOneCCLEnvVar("CCL_LOCAL_SIZE", local_world_size);
-  }
+  });
 
 #ifdef NDEBUG
     TORCH_CHECK(!oneccl_bindings_for_pytorch_wait_gdb(), "Cannot force torch ccl wait for gdb attaching in release version");
@@ -723,9 +904,61 @@ ProcessGroupCCL::ProcessGroupCCL(const c10::intrusive_ptr<Store>& store, int ran
 
 ProcessGroupCCL::~ProcessGroupCCL()
 {
+  // Allreduces still in the batch were never launched, fail them rather than
+  // leave their waiters hanging.
+  std::lock_guard<std::mutex> lock(batch_mutex_);
+  for (auto& work : batch_) {
+    work->pending_.store(false);
+    work->complete(std::make_exception_ptr(std::runtime_error(
+        "ProcessGroupCCL: the group was destroyed before its batched allreduce was launched")));
+  }
+  batch_.clear();
+}
+
+std::map<std::string, double> ProcessGroupCCL::getCallbackStats()
+{
+  if (!callbackExecutor_) {
+    return {};
+  }
+  return callbackExecutor_->stats();
+}
+
+std::string ProcessGroupCCL::dumpInFlightOps()
+{
+  if (!watchdog_) {
+    return "";
+  }
+  return watchdog_->dumpInFlight();
+}
+
+oneccl_bindings_for_pytorch::CommHandles ProcessGroupCCL::getCommHandles(const at::Device& device)
+{
+  // Later ops of the group must not overtake what the batch holds.
+  flushBatchedAllreduces();
+  auto comms = DispatchStub::get_comms(device, *this);
+  TORCH_CHECK(comms && !comms->comms.empty(), "ProcessGroupCCL: no communicator for device ", device);
+  oneccl_bindings_for_pytorch::CommHandles handles;
+  handles.communicator = &comms->comms[0];
+  handles.stream = comms->streams.empty() ? nullptr : &comms->streams[0];
+  handles.owner = comms;
+  handles.kvs = ccl_member_->kvs;
+  handles.rank = getRank();
+  handles.size = getSize();
+  return handles;
+}
+
+void* ProcessGroupCCL::newCommHandles(const at::Device& device)
+{
+  return new oneccl_bindings_for_pytorch::CommHandles(getCommHandles(device));
+}
+
+void ProcessGroupCCL::deleteCommHandles(void* handles)
+{
+  delete static_cast<oneccl_bindings_for_pytorch::CommHandles*>(handles);
 }
 
 void ProcessGroupCCL::startCoalescing() {
+    flushBatchedAllreduces();
     // TODO: GroupStart
     // Currently oneccl dost not support group execution like NCCL, just mark here.
     coalescedDevices_.clear();
@@ -748,6 +981,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::broadcast(
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::broadcast", tensor_param);
 
   checkRank(opts.rootRank, getSize());
+  flushBatchedAllreduces();
   auto work = DispatchStub::broadcast(tensors, opts, *this);
 
   return work;
@@ -761,10 +995,155 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::allreduce(
   format_tensors_param(tensor_param, tensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::allreduce", tensor_param);
 
+  if (batch_allreduce_ && !is_coalescing_ && tensors.size() == 1) {
+    auto& tensor = tensors[0];
+    bool batchable = tensor.device().is_cpu() && tensor.layout() == c10::kStrided &&
+                     tensor.is_contiguous() && static_cast<int64_t>(tensor.nbytes()) <= batch_max_bytes_ &&
+                     (opts.reduceOp == c10d::ReduceOp::SUM || opts.reduceOp == c10d::ReduceOp::PRODUCT ||
+                      opts.reduceOp == c10d::ReduceOp::MIN || opts.reduceOp == c10d::ReduceOp::MAX);
+    if (batchable) {
+      std::unique_lock<std::mutex> lock(batch_mutex_);
+      if (!batch_.empty() && (!(batch_opts_.reduceOp == opts.reduceOp) ||
+                              batch_[0]->tensor_.scalar_type() != tensor.scalar_type())) {
+        lock.unlock();
+        flushBatchedAllreduces();
+        lock.lock();
+      }
+      if (batch_.empty()) {
+        batch_opts_ = opts;
+      }
+      auto self = c10::intrusive_ptr<ProcessGroupCCL>::unsafe_reclaim_from_nonowning(this);
+      auto work = c10::make_intrusive<BatchedWorkCCL>(
+          c10::weak_intrusive_ptr<ProcessGroupCCL>(self), tensor, getRank());
+      batch_.push_back(work);
+      bool full = static_cast<int64_t>(batch_.size()) >= batch_max_ops_;
+      lock.unlock();
+      if (full) {
+        flushBatchedAllreduces();
+      }
+      return work;
+    }
+  }
+
+  flushBatchedAllreduces();
   auto work = DispatchStub::allreduce(tensors, opts, *this);
   return work;
 }
 
+void ProcessGroupCCL::flushBatchedAllreduces()
+{
+  // Launching under the lock keeps batches in issue order when several
+  // threads share the group. The callback is added after the lock is dropped
+  // since it may complete the works inline and run their callbacks.
+  std::unique_lock<std::mutex> lock(batch_mutex_);
+  if (batch_.empty()) {
+    return;
+  }
+  auto batch = std::move(batch_);
+  batch_.clear();
+
+  std::vector<at::Tensor> flat;
+  if (batch.size() == 1) {
+    flat.push_back(batch[0]->tensor_);
+  } else {
+    int64_t numel = 0;
+    for (auto& work : batch) {
+      numel += work->tensor_.numel();
+    }
+    flat.push_back(at::empty({numel}, batch[0]->tensor_.options()));
+    int64_t offset = 0;
+    for (auto& work : batch) {
+      int64_t n = work->tensor_.numel();
+      flat[0].narrow(0, offset, n).copy_(work->tensor_.view(-1));
+      offset += n;
+    }
+  }
+
+  c10::intrusive_ptr<C10D_Work> packed;
+  try {
+    packed = DispatchStub::allreduce(flat, batch_opts_, *this);
+  } catch (...) {
+    auto eptr = std::current_exception();
+    for (auto& work : batch) {
+      work->pending_.store(false);
+    }
+    lock.unlock();
+    for (auto& work : batch) {
+      work->complete(eptr);
+    }
+    throw;
+  }
+  for (auto& work : batch) {
+    work->packed_ = packed;
+    work->pending_.store(false);
+  }
+  lock.unlock();
+
+  auto packedTensor = flat[0];
+  packed->getFuture()->addCallback([batch, packedTensor](c10::ivalue::Future& future) {
+    if (future.hasError()) {
+      for (auto& work : batch) {
+        work->complete(future.exception_ptr());
+      }
+      return;
+    }
+    int64_t offset = 0;
+    for (auto& work : batch) {
+      int64_t n = work->tensor_.numel();
+      if (batch.size() > 1) {
+        work->tensor_.view(-1).copy_(packedTensor.narrow(0, offset, n));
+      }
+      offset += n;
+      work->complete(nullptr);
+    }
+  });
+}
+
+void ProcessGroupCCL::allreduceDirect(at::Tensor& tensor, const AllreduceOptions& opts)
+{
+  flushBatchedAllreduces();
+  DispatchStub::allreduce_direct(tensor, opts, *this);
+}
+
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::allgatherv(at::Tensor& input)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, input);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::allgatherv", tensor_param);
+
+  flushBatchedAllreduces();
+  return DispatchStub::allgatherv(input, *this);
+}
+
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::broadcastWithSize(at::Tensor& input, int64_t root)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, input);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::broadcast_with_size", tensor_param);
+
+  TORCH_CHECK(root >= 0 && root < getSize(), "broadcast_with_size: invalid root rank ", root);
+  flushBatchedAllreduces();
+  return DispatchStub::broadcast_with_size(input, root, *this);
+}
+
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::sendrecv(
+    at::Tensor& sendTensor,
+    at::Tensor& recvTensor,
+    int dstRank,
+    int srcRank)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, sendTensor);
+  format_tensors_param(tensor_param, recvTensor);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::sendrecv", tensor_param);
+
+  checkRank(dstRank, getSize());
+  checkRank(srcRank, getSize());
+  flushBatchedAllreduces();
+  auto work = DispatchStub::sendrecv(sendTensor, recvTensor, dstRank, srcRank, *this);
+  return work;
+}
+
 c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::allreduce_coalesced(
     std::vector<at::Tensor>& tensors,
     const AllreduceCoalescedOptions& opts)
@@ -773,6 +1152,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::allreduce_coalesced(
   format_tensors_param(tensor_param, tensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::allreduce_coalesced", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::allreduce_coalesced(tensors, opts, *this);
   return work;
 }
@@ -786,6 +1166,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::reduce(
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::reduce", tensor_param);
 
   checkRank(opts.rootRank, getSize());
+  flushBatchedAllreduces();
   auto work = DispatchStub::reduce(tensors, opts, *this);
   return work;
 }
@@ -801,6 +1182,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::allgather(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::allgather", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::allgather(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -814,10 +1196,88 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::_allgather_base(
   format_tensors_param(tensor_param, inputTensor);
   format_tensors_param(tensor_param, outputTensor);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::_allgather_base", tensor_param);
+  flushBatchedAllreduces();
   auto work = DispatchStub::_allgather_base(outputTensor, inputTensor, opts, *this);
   return work;
 }
 
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::_allgather_base_quantized(
+      at::Tensor& outputTensor,
+      at::Tensor& inputTensor,
+      const std::string& quant,
+      int64_t blockSize)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, inputTensor);
+  format_tensors_param(tensor_param, outputTensor);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::_allgather_base_quantized", tensor_param);
+
+  auto quant_type = oneccl_bindings_for_pytorch::parseCommQuantType(quant);
+  flushBatchedAllreduces();
+  auto work = DispatchStub::_allgather_base_quantized(outputTensor, inputTensor, quant_type, blockSize, *this);
+  return work;
+}
+
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::_allreduce_topk(
+      at::Tensor& tensor,
+      double ratio,
+      int64_t key)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, tensor);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::_allreduce_topk", tensor_param);
+
+  flushBatchedAllreduces();
+  auto work = DispatchStub::_allreduce_topk(tensor, ratio, key, *this);
+  return work;
+}
+
+void ProcessGroupCCL::clearTopKResiduals()
+{
+  topk_residuals_->clear();
+}
+
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::_allreduce_partial(
+      at::Tensor& tensor,
+      bool contribute,
+      int64_t key)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, tensor);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::_allreduce_partial", tensor_param);
+
+  flushBatchedAllreduces();
+  auto work = DispatchStub::_allreduce_partial(tensor, contribute, key, *this);
+  return work;
+}
+
+void ProcessGroupCCL::clearPartialResiduals()
+{
+  partial_residuals_->clear();
+}
+
+c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::_allreduce_custom(
+      at::Tensor& tensor,
+      const std::string& reduction)
+{
+  std::vector<c10::IValue> tensor_param;
+  format_tensors_param(tensor_param, tensor);
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::_allreduce_custom", tensor_param);
+
+  flushBatchedAllreduces();
+  auto work = DispatchStub::_allreduce_custom(tensor, reduction, *this);
+  return work;
+}
+
+void ProcessGroupCCL::setAllgatherQuantization(const std::string& quant, int64_t blockSize, int64_t minBytes)
+{
+  TORCH_CHECK(blockSize > 0, "quantization block size must be positive");
+  TORCH_CHECK(minBytes >= 0, "quantization min bytes must be non-negative");
+  allgather_quant_ = oneccl_bindings_for_pytorch::parseCommQuantType(quant);
+  allgather_quant_block_ = blockSize;
+  allgather_quant_min_bytes_ = minBytes;
+}
+
 c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::allgather_coalesced(
     std::vector<std::vector<at::Tensor>>& /* unused */,
     std::vector<at::Tensor>& /* unused */,
@@ -836,6 +1296,7 @@ c10::intrusive_ptr<Work> ProcessGroupCCL::allgather_into_tensor_coalesced(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::allgather_into_tensor_coalesced", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::allgather_into_tensor_coalesced(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -850,6 +1311,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::gather(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::gather", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::gather(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -864,6 +1326,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::scatter(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::scatter", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::scatter(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -878,6 +1341,19 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::reduce_scatter(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::reduce_scatter", tensor_param);
 
+  if (isPremulSum(opts.reduceOp)) {
+    std::vector<std::vector<at::Tensor>> scaled(inputTensors.size());
+    for (size_t i = 0; i < inputTensors.size(); i++) {
+      for (auto& input : inputTensors[i]) {
+        scaled[i].push_back(input.mul(premulFactor(opts.reduceOp, input)));
+      }
+    }
+    ReduceScatterOptions sumOpts = opts;
+    sumOpts.reduceOp = c10d::ReduceOp::SUM;
+    return reduce_scatter(outputTensors, scaled, sumOpts);
+  }
+
+  flushBatchedAllreduces();
   auto work = DispatchStub::reduce_scatter(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -891,6 +1367,13 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::_reduce_scatter_base(
      format_tensors_param(tensor_param, inputTensor);
      format_tensors_param(tensor_param, outputTensor);
      RECORD_FUNCTION("oneccl_bindings_for_pytorch::_reduce_scatter_base", tensor_param);
+     if (isPremulSum(opts.reduceOp)) {
+       auto scaled = inputTensor.mul(premulFactor(opts.reduceOp, inputTensor));
+       ReduceScatterOptions sumOpts = opts;
+       sumOpts.reduceOp = c10d::ReduceOp::SUM;
+       return _reduce_scatter_base(outputTensor, scaled, sumOpts);
+     }
+     flushBatchedAllreduces();
      auto work = DispatchStub::_reduce_scatter_base(outputTensor, inputTensor, opts, *this);
      return work;
 }
@@ -905,6 +1388,7 @@ c10::intrusive_ptr<Work> ProcessGroupCCL::reduce_scatter_tensor_coalesced(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::reduce_scatter_tensor_coalesced", tensor_param);
   
+  flushBatchedAllreduces();
   auto work = DispatchStub::reduce_scatter_tensor_coalesced(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -921,6 +1405,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::alltoall_base(
   format_tensors_param(tensor_param, outputTensor);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::alltoall_base", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::alltoall_base(outputTensor, inputTensor, outputSplitSizes, inputSplitSizes, opts, *this);
   return work;
 }
@@ -935,6 +1420,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::alltoall(
   format_tensors_param(tensor_param, outputTensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::alltoall", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::alltoall(outputTensors, inputTensors, opts, *this);
   return work;
 }
@@ -948,6 +1434,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::send(
   format_tensors_param(tensor_param, tensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::send", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::send(tensors, dstRank, tag, *this);
   return work;
 }
@@ -961,6 +1448,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::recv(
   format_tensors_param(tensor_param, tensors);
   RECORD_FUNCTION("oneccl_bindings_for_pytorch::recv", tensor_param);
 
+  flushBatchedAllreduces();
   auto work = DispatchStub::recv(tensors, srcRank, tag, *this);
   return work;
 }
@@ -975,6 +1463,7 @@ c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::recvAnysource(
 c10::intrusive_ptr<C10D_Work> ProcessGroupCCL::barrier(
     const BarrierOptions& opts)
 {
+ flushBatchedAllreduces();
  return DispatchStub::barrier(opts, *this);
 }
 
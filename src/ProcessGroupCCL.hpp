@@ -32,7 +32,9 @@
 #pragma once
 
 
+#include <atomic>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -56,9 +58,17 @@
 #include <c10d/Utils.hpp>
 #endif
 
+#include "quantization.h"
+#include "sparse_codec.h"
+#include "topk_compress.h"
+#include "callback_executor.h"
+#include "in_flight_limiter.h"
+#include "comm_stats.h"
+#include "watchdog.h"
 
 namespace oneccl_bindings_for_pytorch {
 struct CCLCommCollector;
+struct CommHandles;
 
 static inline void format_tensors_param(std::vector<c10::IValue>& param, const at::Tensor& tensor) {
   param.emplace_back(tensor);
@@ -101,6 +111,40 @@ constexpr const char* CCL_SAME_STREAM = "CCL_SAME_STREAM";
 
 constexpr const char* TORCH_LLM_ALLREDUCE = "TORCH_LLM_ALLREDUCE";
 
+// Environment variable which selects the wire format (none, int8 or fp8) of
+// _allgather_base on CPU, the number of elements sharing one scale, and the
+// shard size in bytes below which the allgather stays exact.
+constexpr const char* TORCH_CCL_ALLGATHER_QUANT = "TORCH_CCL_ALLGATHER_QUANT";
+constexpr const char* TORCH_CCL_ALLGATHER_QUANT_BLOCK = "TORCH_CCL_ALLGATHER_QUANT_BLOCK";
+constexpr const char* TORCH_CCL_ALLGATHER_QUANT_MIN_BYTES = "TORCH_CCL_ALLGATHER_QUANT_MIN_BYTES";
+
+// Environment variable which controls whether bf16/fp16 SUM allreduce on CPU
+// accumulates in fp32 while keeping the reduced precision type on the wire.
+constexpr const char* TORCH_CCL_ALLREDUCE_FP32_ACCUM = "TORCH_CCL_ALLREDUCE_FP32_ACCUM";
+
+// Environment variable which sets the number of threads running the future
+// callbacks of CPU works. 0 runs them inline on the progress thread.
+constexpr const char* TORCH_CCL_CALLBACK_THREADS = "TORCH_CCL_CALLBACK_THREADS";
+
+// Environment variable which moves the oneCCL launch of CPU collectives from
+// the caller to a submission thread, so that async ops return right away.
+constexpr const char* TORCH_CCL_ASYNC_SUBMIT = "TORCH_CCL_ASYNC_SUBMIT";
+
+// Environment variable which lets _allgather_base and alltoall_base on CPU
+// send zero heavy payloads losslessly compressed.
+constexpr const char* TORCH_CCL_SPARSE_COMM = "TORCH_CCL_SPARSE_COMM";
+
+// Environment variables which let small single tensor allreduces on CPU,
+// issued back to back with the same op and dtype, travel as one allreduce
+// of up to TORCH_CCL_BATCH_MAX_OPS tensors of up to TORCH_CCL_BATCH_MAX_BYTES.
+constexpr const char* TORCH_CCL_BATCH_ALLREDUCE = "TORCH_CCL_BATCH_ALLREDUCE";
+constexpr const char* TORCH_CCL_BATCH_MAX_OPS = "TORCH_CCL_BATCH_MAX_OPS";
+constexpr const char* TORCH_CCL_BATCH_MAX_BYTES = "TORCH_CCL_BATCH_MAX_BYTES";
+
+// Environment variable which bounds the CPU works of a group that were issued
+// and have not completed yet. Issuing one more blocks until one completes.
+constexpr const char* TORCH_CCL_MAX_IN_FLIGHT = "TORCH_CCL_MAX_IN_FLIGHT";
+
 #if TORCH_VERSION_MAJOR > 1
 using Baseclass = Backend;
 #else
@@ -109,6 +153,53 @@ using Baseclass = ProcessGroup;
 class ProcessGroupCCL : public Baseclass 
 {
 public:
+  // Per group settings, passed through
+  // torch.distributed.new_group(backend="ccl", pg_options=...). Fields left
+  // unset fall back to the environment variables, so that e.g. the TP and DP
+  // groups of one job can be tuned separately.
+  struct Options : Baseclass::Options {
+    explicit Options(std::chrono::milliseconds timeout = kProcessGroupDefaultTimeout);
+
+    static c10::intrusive_ptr<Options> create(
+        std::chrono::milliseconds timeout = kProcessGroupDefaultTimeout) {
+      return c10::make_intrusive<Options>(timeout);
+    }
+
+    // Overrides CCL_BLOCKING_WAIT.
+    c10::optional<bool> blocking_wait;
+    // Overrides CCL_SAME_STREAM.
+    c10::optional<bool> same_stream;
+    // oneCCL priority of the group's operations. Higher values are scheduled first.
+    c10::optional<int64_t> priority;
+    // Override TORCH_CCL_ALLGATHER_QUANT, TORCH_CCL_ALLGATHER_QUANT_BLOCK and
+    // TORCH_CCL_ALLGATHER_QUANT_MIN_BYTES.
+    c10::optional<std::string> allgather_quant;
+    c10::optional<int64_t> allgather_quant_block;
+    c10::optional<int64_t> allgather_quant_min_bytes;
+    // Overrides TORCH_CCL_ALLREDUCE_FP32_ACCUM.
+    c10::optional<bool> allreduce_fp32_accum;
+    // Overrides TORCH_CCL_CALLBACK_THREADS.
+    c10::optional<int64_t> callback_threads;
+    // Overrides TORCH_CCL_ASYNC_SUBMIT.
+    c10::optional<bool> async_submit;
+    // Overrides TORCH_CCL_SPARSE_COMM.
+    c10::optional<bool> sparse_comm;
+    // Override TORCH_CCL_BATCH_ALLREDUCE, TORCH_CCL_BATCH_MAX_OPS and
+    // TORCH_CCL_BATCH_MAX_BYTES. With batching on, every rank has to launch
+    // each batch at the same point of the group's op sequence: the first
+    // wait() on a batched work or flush must follow the same allreduce on all
+    // ranks. Mismatched batches are not detected and hang or mix tensors.
+    c10::optional<bool> batch_allreduce;
+    c10::optional<int64_t> batch_max_ops;
+    c10::optional<int64_t> batch_max_bytes;
+    // Overrides TORCH_CCL_MAX_IN_FLIGHT.
+    c10::optional<int64_t> max_in_flight;
+    // Overrides TORCH_LLM_ALLREDUCE for the group's stream and wait defaults.
+    // The oneCCL settings it implies are process wide and only follow the
+    // environment variable.
+    c10::optional<bool> llm_allreduce;
+  };
+
   class AsyncWorkCCL : public C10D_Work {
   public:
     AsyncWorkCCL(std::vector<std::vector<at::Tensor>> outputTensors,
@@ -127,12 +218,44 @@ public:
 
     void finishAsyncWorkCCLError(std::exception_ptr eptr);
 
+    // Count the work as completed in the stats file and the watchdog, at most
+    // once, and give back its slot of the group's in-flight limit.
+    void recordCompletion(bool error);
+
+    // Drop the references to inputs and staging buffers once the transport
+    // has completed. The outputs stay alive for result() and the future.
+    virtual void releaseResources();
+
   public:
     std::string debugName;
     // Clone of blockingWait_ from ProcessGroupCCL.
     bool blockingWait_ = true;
     // Clone of useSameStream_ from ProcessGroupCCL.
     bool useSameStream_ = false;
+    // Runs on the worker thread once the transport has completed, before the
+    // future is marked. Used to unpack staging buffers into the outputs.
+    std::function<void()> postProcess_;
+    // Clone of callbackExecutor_ from ProcessGroupCCL for CPU works. When set,
+    // the future is marked (and its callbacks run) on the executor.
+    std::shared_ptr<oneccl_bindings_for_pytorch::CallbackExecutor> callbackExecutor_;
+    // Clone of asyncSubmit_ from ProcessGroupCCL for CPU works.
+    bool asyncSubmit_ = false;
+    // Set by CPU ops whose run() waits for an intermediate stage before it
+    // launches the next one. Such works run on the submission thread so the
+    // caller does not block on the first stage.
+    bool staged_ = false;
+    // False while the work waits for the submission thread to run() it.
+    std::atomic<bool> launched_{true};
+    // Clones of commStats_ and watchdog_ from ProcessGroupCCL, with the
+    // sequence numbers of the work in each. Set when the work is created.
+    std::shared_ptr<oneccl_bindings_for_pytorch::CommStatsPublisher> commStats_;
+    uint64_t statsSeq_ = 0;
+    std::shared_ptr<oneccl_bindings_for_pytorch::CommWatchdog> watchdog_;
+    uint64_t watchdogSeq_ = 0;
+    std::chrono::steady_clock::time_point issueTime_;
+    std::atomic<bool> completionRecorded_{false};
+    // Slot of the group's in-flight limit, null when there is none.
+    std::shared_ptr<oneccl_bindings_for_pytorch::InFlightLimiter::Slot> inFlightSlot_;
 
   protected:
     friend class ProcessGroupCCL;
@@ -141,10 +264,45 @@ public:
     c10::intrusive_ptr<at::ivalue::Future> future_;
   };
 
+  // Work of a small allreduce waiting in the group's batch. The batch is
+  // launched when it is full, when the group issues a different op, on
+  // flushBatchedAllreduces() or when one of its works is waited on. The
+  // caller has to make all of these happen at the same point of the op
+  // sequence on every rank, nothing checks it. Querying the work or
+  // taking its future launches nothing, since ranks do that independently,
+  // e.g. only rank 0 polling for logging.
+  class BatchedWorkCCL : public C10D_Work {
+  public:
+    BatchedWorkCCL(c10::weak_intrusive_ptr<ProcessGroupCCL> pg, at::Tensor tensor, int rank);
+
+    bool isCompleted() override;
+
+    bool wait(std::chrono::milliseconds timeout = kNoTimeout) override;
+
+    c10::intrusive_ptr<c10::ivalue::Future> getFuture() override;
+
+    std::vector<at::Tensor> result() override;
+
+  private:
+    friend class ProcessGroupCCL;
+    void complete(std::exception_ptr eptr);
+
+    // Weak, the work may outlive the group, whose destructor fails the
+    // works it never launched.
+    c10::weak_intrusive_ptr<ProcessGroupCCL> pg_;
+    at::Tensor tensor_;
+    // True until the batch holding the work is launched.
+    std::atomic<bool> pending_{true};
+    // The allreduce of the batch, null until it is launched.
+    c10::intrusive_ptr<C10D_Work> packed_;
+    c10::intrusive_ptr<at::ivalue::Future> future_;
+  };
+
   explicit ProcessGroupCCL(const c10::intrusive_ptr<Store>& store,
                            int rank,
                            int size,
-                           std::chrono::milliseconds);
+                           std::chrono::milliseconds,
+                           c10::intrusive_ptr<Options> options = Options::create());
   virtual ~ProcessGroupCCL();
 
 #if TORCH_VERSION_MINOR >= 11
@@ -184,6 +342,71 @@ public:
       at::Tensor& inputBuffer,
       const AllgatherOptions& opts = AllgatherOptions()) override;
 
+  // Synchronous in-place allreduce without a work, the profiler record and
+  // the c10d dispatcher, for latency bound loops.
+  void allreduceDirect(at::Tensor& tensor, const AllreduceOptions& opts = AllreduceOptions());
+
+  // Launches the small allreduces batched so far. Every other op of the
+  // group calls it first, so ops keep their order on the communicator.
+  void flushBatchedAllreduces();
+
+  // Allgather of 1-D uint8 tensors of any size, for object collectives.
+  // The work's result is the payloads back to back and the size of each.
+  c10::intrusive_ptr<C10D_Work> allgatherv(at::Tensor& input);
+
+  // Broadcast of a 1-D uint8 tensor whose size only `root` knows. The work's
+  // result is the broadcast tensor.
+  c10::intrusive_ptr<C10D_Work> broadcastWithSize(at::Tensor& input, int64_t root);
+
+  // Sends `sendTensor` to `dstRank` and receives `recvTensor` from `srcRank`
+  // at the same time, e.g. one hop of a ring. Every rank of the group has
+  // to call it, the work completes once both directions are done.
+  c10::intrusive_ptr<C10D_Work> sendrecv(
+      at::Tensor& sendTensor,
+      at::Tensor& recvTensor,
+      int dstRank,
+      int srcRank);
+
+  // _allgather_base with each rank's shard quantized to `quant` on the wire.
+  c10::intrusive_ptr<C10D_Work> _allgather_base_quantized(
+      at::Tensor& outputBuffer,
+      at::Tensor& inputBuffer,
+      const std::string& quant,
+      int64_t blockSize = oneccl_bindings_for_pytorch::kDefaultQuantBlockSize);
+
+  // SUM allreduce of the top `ratio` entries of every chunk of `tensor` plus
+  // the residual left by the previous calls with the same `key`.
+  c10::intrusive_ptr<C10D_Work> _allreduce_topk(
+      at::Tensor& tensor,
+      double ratio,
+      int64_t key = 0);
+
+  // Drops the top-k error feedback of the group.
+  void clearTopKResiduals();
+
+  // SUM allreduce to which only the ranks passing `contribute` add their
+  // `tensor`, plus what they held back in earlier calls with the same `key`.
+  // The others keep `tensor` for a later call. The work's result is the sum
+  // and a bool tensor of the ranks which contributed.
+  c10::intrusive_ptr<C10D_Work> _allreduce_partial(
+      at::Tensor& tensor,
+      bool contribute,
+      int64_t key = 0);
+
+  // Drops the contributions held back by _allreduce_partial.
+  void clearPartialResiduals();
+
+  // In-place allreduce of `tensor` with a reduction registered through
+  // oneccl_bindings_for_pytorch::registerReduction, see custom_reduction.h.
+  c10::intrusive_ptr<C10D_Work> _allreduce_custom(
+      at::Tensor& tensor,
+      const std::string& reduction);
+
+  void setAllgatherQuantization(
+      const std::string& quant,
+      int64_t blockSize = oneccl_bindings_for_pytorch::kDefaultQuantBlockSize,
+      int64_t minBytes = oneccl_bindings_for_pytorch::kDefaultQuantMinBytes);
+
   c10::intrusive_ptr<C10D_Work> allgather_coalesced(
       std::vector<std::vector<at::Tensor>>& outputTensorLists,
       std::vector<at::Tensor>& inputTensors,
@@ -257,8 +480,27 @@ public:
       const c10::intrusive_ptr<Store>& store,
       int rank = -1,
       int size = -1,
-      std::chrono::milliseconds op_time_out = kNoTimeout);
+      std::chrono::milliseconds op_time_out = kNoTimeout,
+      c10::intrusive_ptr<Options> options = Options::create());
   static const int64_t OP_TIMEOUT_MILLIS;
+
+  c10::intrusive_ptr<Options> getOptions() {
+    return options_;
+  }
+
+  std::map<std::string, double> getCallbackStats();
+
+  // Table of the in-flight ops, empty when the watchdog is disabled.
+  std::string dumpInFlightOps();
+
+  // The communicator, stream and KVS the group uses for `device`, created
+  // if the group has not run an op there yet. See comm_handles.h.
+  oneccl_bindings_for_pytorch::CommHandles getCommHandles(const at::Device& device);
+
+  // Heap copy of getCommHandles for the Python capsule, so that the bindings
+  // do not need the oneCCL headers.
+  void* newCommHandles(const at::Device& device);
+  static void deleteCommHandles(void* handles);
  public:
 
   static void cclInitOnce();
@@ -271,6 +513,8 @@ public:
 
   std::unique_ptr<oneccl_bindings_for_pytorch::CCLCommCollector> ccl_member_;
 
+  const c10::intrusive_ptr<Options> options_;
+
   static std::mutex globalMutex;
 
   // Whether or not wait() and synchronize() are blocking operations that wait
@@ -283,6 +527,57 @@ public:
 
   bool torch_llm_allreduce_ = false;
 
+  // oneCCL operation priority, 0 keeps the oneCCL default.
+  int64_t op_priority_ = 0;
+
+  // Runs the future callbacks of the group's CPU works, null to run them inline.
+  std::shared_ptr<oneccl_bindings_for_pytorch::CallbackExecutor> callbackExecutor_;
+
+  // Whether the group's CPU collectives are launched by the submission thread.
+  bool asyncSubmit_ = false;
+
+  // Bounds the group's in-flight CPU works, null when unbounded.
+  std::shared_ptr<oneccl_bindings_for_pytorch::InFlightLimiter> inFlightLimiter_;
+
+  // Publishes the op counters to /dev/shm when TORCH_CCL_STATS_SHM is set.
+  std::shared_ptr<oneccl_bindings_for_pytorch::CommStatsPublisher> commStats_;
+
+  // Reports the slow in-flight ops when TORCH_CCL_WATCHDOG_INTERVAL_MS is set.
+  std::shared_ptr<oneccl_bindings_for_pytorch::CommWatchdog> watchdog_;
+
+  // Wire format of _allgather_base for floating point shards of at least
+  // allgather_quant_min_bytes_ on CPU.
+  oneccl_bindings_for_pytorch::CommQuantType allgather_quant_ =
+      oneccl_bindings_for_pytorch::CommQuantType::NONE;
+  int64_t allgather_quant_block_ = oneccl_bindings_for_pytorch::kDefaultQuantBlockSize;
+  int64_t allgather_quant_min_bytes_ = oneccl_bindings_for_pytorch::kDefaultQuantMinBytes;
+
+  // Whether bf16/fp16 SUM allreduce on CPU accumulates in fp32.
+  bool allreduce_fp32_accum_ = false;
+
+  // Whether _allgather_base and alltoall_base on CPU try the sparse encoding,
+  // and when the group backs off to dense.
+  bool sparse_comm_ = false;
+  std::shared_ptr<oneccl_bindings_for_pytorch::SparseCommPolicy> sparse_policy_ =
+      std::make_shared<oneccl_bindings_for_pytorch::SparseCommPolicy>();
+
+  // Error feedback buffers of _allreduce_topk.
+  std::shared_ptr<oneccl_bindings_for_pytorch::TopKResiduals> topk_residuals_ =
+      std::make_shared<oneccl_bindings_for_pytorch::TopKResiduals>();
+
+  // Contributions held back by _allreduce_partial, same layout as above.
+  std::shared_ptr<oneccl_bindings_for_pytorch::TopKResiduals> partial_residuals_ =
+      std::make_shared<oneccl_bindings_for_pytorch::TopKResiduals>();
+
+  // Open batch of small allreduces, see TORCH_CCL_BATCH_ALLREDUCE. All its
+  // works share one op and dtype.
+  bool batch_allreduce_ = false;
+  int64_t batch_max_ops_ = 32;
+  int64_t batch_max_bytes_ = 1024;
+  std::mutex batch_mutex_;
+  std::vector<c10::intrusive_ptr<BatchedWorkCCL>> batch_;
+  AllreduceOptions batch_opts_;
+
   // Flag to denote if a coalescing groupStart/groupEnd block is active
   bool is_coalescing_ = false;
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <c10/util/Exception.h>
+
+#include "callback_executor.h"
+#include "in_flight_limiter.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+CallbackExecutor::CallbackExecutor(int num_threads, size_t capacity)
+    : capacity_(capacity), state_(std::make_shared<State>()) {
+  TORCH_CHECK(num_threads > 0, "CallbackExecutor needs at least one thread");
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&CallbackExecutor::runLoop, state_);
+  }
+}
+
+CallbackExecutor::~CallbackExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stop = true;
+  }
+  state_->cv.notify_all();
+  // The threads drain the queue before they exit.
+  for (auto& thread : threads_) {
+    if (thread.get_id() == std::this_thread::get_id()) {
+      thread.detach();
+    } else {
+      thread.join();
+    }
+  }
+}
+
+void CallbackExecutor::submit(std::function<void()> fn) {
+  Task task{std::move(fn), std::chrono::steady_clock::now()};
+  {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    if (state_->queue.size() >= capacity_) {
+      lock.unlock();
+      state_->inlined++;
+      runTask(*state_, task);
+      return;
+    }
+    state_->queue.push_back(std::move(task));
+  }
+  state_->cv.notify_one();
+}
+
+std::map<std::string, double> CallbackExecutor::stats() {
+  size_t pending;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    pending = state_->queue.size();
+  }
+  const uint64_t dispatched = state_->dispatched.load();
+  return {
+    {"dispatched", static_cast<double>(dispatched)},
+    {"inlined", static_cast<double>(state_->inlined.load())},
+    {"pending", static_cast<double>(pending)},
+    {"avg_queue_delay_us", dispatched ? state_->totalDelayNs.load() / 1e3 / dispatched : 0.0},
+    {"max_queue_delay_us", state_->maxDelayNs.load() / 1e3},
+  };
+}
+
+void CallbackExecutor::runTask(State& state, Task& task) {
+  const uint64_t delay = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - task.enqueued).count();
+  state.dispatched++;
+  state.totalDelayNs += delay;
+  uint64_t max_delay = state.maxDelayNs.load();
+  while (delay > max_delay && !state.maxDelayNs.compare_exchange_weak(max_delay, delay)) {
+  }
+
+  try {
+    task.fn();
+  } catch (const std::exception& e) {
+    TORCH_WARN("oneccl_bindings_for_pytorch: future callback failed: ", e.what());
+  }
+}
+
+void CallbackExecutor::runLoop(std::shared_ptr<State> state) {
+  InFlightLimiter::exemptCurrentThread();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (true) {
+    state->cv.wait(lock, [&] { return state->stop || !state->queue.empty(); });
+    if (state->queue.empty()) {
+      return;
+    }
+    Task task = std::move(state->queue.front());
+    state->queue.pop_front();
+    lock.unlock();
+
+    runTask(*state, task);
+    // Drop what the callback captured, which may be the last reference to
+    // the executor, before taking the lock again.
+    task.fn = nullptr;
+
+    lock.lock();
+  }
+}
+
+} // namespace oneccl_bindings_for_pytorch
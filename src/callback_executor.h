@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Number of callbacks which may wait for a thread of a CallbackExecutor.
+constexpr size_t kCallbackQueueCapacity = 1024;
+
+// Fixed size thread pool running the future callbacks (DDP comm hooks, FSDP
+// post reduce logic, ...) of completed works, so that a heavy callback does
+// not hold up the progress thread noticing the next completion. With one
+// thread the callbacks run in completion order.
+//
+// The queue is bounded. When it is full, submit() runs the callback on the
+// calling thread, which slows the producer down to the pool's pace without
+// ever blocking it: a callback waiting for a work which only the blocked
+// producer could complete would deadlock. Such a callback may overtake the
+// queued ones.
+class CallbackExecutor {
+public:
+  explicit CallbackExecutor(int num_threads, size_t capacity = kCallbackQueueCapacity);
+  ~CallbackExecutor();
+
+  CallbackExecutor(const CallbackExecutor&) = delete;
+  CallbackExecutor& operator=(const CallbackExecutor&) = delete;
+
+  void submit(std::function<void()> fn);
+
+  // Number of dispatched callbacks, the ones run by the submitting thread as
+  // the queue was full, the ones still queued, and the average and maximum
+  // time a callback waited for a thread in microseconds.
+  std::map<std::string, double> stats();
+
+private:
+  struct Task {
+    std::function<void()> fn;
+    std::chrono::steady_clock::time_point enqueued;
+  };
+
+  // Shared with the threads. The last reference to the executor may be
+  // dropped by a callback, e.g. with the work holding it; the thread running
+  // that callback is then detached instead of joining itself, and keeps the
+  // state alive until it exits.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Task> queue;
+    bool stop = false;
+
+    std::atomic<uint64_t> dispatched{0};
+    std::atomic<uint64_t> inlined{0};
+    std::atomic<uint64_t> totalDelayNs{0};
+    std::atomic<uint64_t> maxDelayNs{0};
+  };
+
+  static void runLoop(std::shared_ptr<State> state);
+  static void runTask(State& state, Task& task);
+
+  const size_t capacity_;
+  std::shared_ptr<State> state_;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace oneccl_bindings_for_pytorch
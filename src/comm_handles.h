@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <oneapi/ccl.hpp>
+
+// Lets C++ extensions, e.g. fused allreduce + norm kernels, issue oneCCL ops
+// on the communicators a ccl process group already built. Only oneCCL headers
+// are needed to use it.
+namespace oneccl_bindings_for_pytorch {
+
+// Name of the PyCapsule returned by oneccl_bindings_for_pytorch.comm_handles.
+constexpr const char* kCommHandlesCapsuleName = "oneccl_bindings_for_pytorch.CommHandles";
+
+// The oneCCL objects a process group runs its collectives on for one device.
+// Ops issued on them are not ordered with the group's own ops: wait for the
+// group's pending works first, and have every rank issue the same sequence.
+struct CommHandles {
+  // Keeps the objects below alive, also after the group is destroyed.
+  std::shared_ptr<void> owner;
+  ccl::communicator* communicator = nullptr;
+  // Null on CPU, where the collectives run without a stream.
+  ccl::stream* stream = nullptr;
+  ccl::shared_ptr_class<ccl::kvs> kvs;
+  int rank = -1;
+  int size = 0;
+};
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <c10/util/Exception.h>
+
+#include "comm_stats.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+std::atomic<int64_t> nextGroupIndex{0};
+
+uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int latencyBucket(uint64_t us) {
+  int bucket = 0;
+  while (us > 1 && bucket < kCommStatsLatencyBuckets - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+} // namespace
+
+std::shared_ptr<CommStatsPublisher> CommStatsPublisher::create(int rank, int size) {
+  const char* env = std::getenv(TORCH_CCL_STATS_SHM);
+  if (env == nullptr || std::atoi(env) == 0) {
+    return nullptr;
+  }
+
+  const int64_t group_index = nextGroupIndex++;
+  const std::string path = "/dev/shm/torch_ccl_stats." + std::to_string(getpid()) + "." +
+                           std::to_string(group_index);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    TORCH_WARN("oneccl_bindings_for_pytorch: cannot create ", path, ": ", strerror(errno),
+               ", communication stats are not published");
+    return nullptr;
+  }
+  if (ftruncate(fd, sizeof(CommStatsLayout)) != 0) {
+    TORCH_WARN("oneccl_bindings_for_pytorch: cannot size ", path, ": ", strerror(errno));
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+  void* ptr = mmap(nullptr, sizeof(CommStatsLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    TORCH_WARN("oneccl_bindings_for_pytorch: cannot map ", path, ": ", strerror(errno));
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  // The file is zero filled by ftruncate, so only the header needs setting.
+  auto* layout = static_cast<CommStatsLayout*>(ptr);
+  layout->version = kCommStatsVersion;
+  layout->rank = rank;
+  layout->size = size;
+  layout->pid = getpid();
+  layout->group_index = group_index;
+  layout->update_time_ns = nowNs();
+  std::atomic_thread_fence(std::memory_order_release);
+  layout->magic = kCommStatsMagic;
+  return std::make_shared<CommStatsPublisher>(path, layout);
+}
+
+CommStatsPublisher::CommStatsPublisher(const std::string& path, CommStatsLayout* layout)
+    : path_(path), layout_(layout) {}
+
+CommStatsPublisher::~CommStatsPublisher() {
+  munmap(layout_, sizeof(CommStatsLayout));
+  unlink(path_.c_str());
+}
+
+template <typename F>
+void CommStatsPublisher::update(F fn) {
+  // The caller and the progress thread both write, the seqlock only orders
+  // them against the readers.
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t seq = layout_->seq.load(std::memory_order_relaxed);
+  layout_->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  fn(*layout_);
+  layout_->update_time_ns = nowNs();
+  layout_->seq.store(seq + 2, std::memory_order_release);
+}
+
+uint64_t CommStatsPublisher::recordIssue(int op_type, int64_t bytes) {
+  const int slot = (op_type >= 0 && op_type < kCommStatsOpSlots) ? op_type : kCommStatsOpSlots - 1;
+  uint64_t seq = 0;
+  update([&](CommStatsLayout& stats) {
+    seq = ++stats.issued;
+    stats.in_flight++;
+    stats.ops[slot]++;
+    stats.bytes[slot] += static_cast<uint64_t>(bytes);
+  });
+  return seq;
+}
+
+void CommStatsPublisher::recordCompletion(uint64_t seq,
+                                          std::chrono::steady_clock::time_point issue_time,
+                                          bool error) {
+  const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - issue_time).count();
+  const int bucket = latencyBucket(us);
+  update([&](CommStatsLayout& stats) {
+    stats.completed++;
+    stats.in_flight--;
+    if (error) {
+      stats.errors++;
+    }
+    if (seq > stats.last_completed_seq) {
+      stats.last_completed_seq = seq;
+    }
+    stats.latency_us_hist[bucket]++;
+  });
+}
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Environment variable which makes every process group publish its counters
+// to /dev/shm/torch_ccl_stats.<pid>.<group index>.
+constexpr const char* TORCH_CCL_STATS_SHM = "TORCH_CCL_STATS_SHM";
+
+constexpr uint64_t kCommStatsMagic = 0x5441545354434354ULL; // "TCCTSTAT"
+constexpr uint64_t kCommStatsVersion = 1;
+// Counters are indexed by c10d::OpType, values past the end go to the last slot.
+constexpr int kCommStatsOpSlots = 32;
+// Bucket i counts the ops whose latency is in [2^i, 2^(i+1)) microseconds.
+constexpr int kCommStatsLatencyBuckets = 32;
+
+// Fixed layout of the stats file, read by oneccl_bindings_for_pytorch/stats.py.
+// Writers bump `seq` to an odd value before and to an even value after an
+// update, readers retry while it is odd or changed during their copy.
+struct CommStatsLayout {
+  uint64_t magic;
+  uint64_t version;
+  std::atomic<uint64_t> seq;
+  int64_t rank;
+  int64_t size;
+  int64_t pid;
+  int64_t group_index;
+  uint64_t issued;
+  uint64_t completed;
+  uint64_t errors;
+  uint64_t in_flight;
+  uint64_t last_completed_seq;
+  uint64_t update_time_ns;
+  uint64_t ops[kCommStatsOpSlots];
+  uint64_t bytes[kCommStatsOpSlots];
+  uint64_t latency_us_hist[kCommStatsLatencyBuckets];
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "seqlock counter must be a plain 64-bit word");
+
+class CommStatsPublisher {
+public:
+  // Returns null unless TORCH_CCL_STATS_SHM is set.
+  static std::shared_ptr<CommStatsPublisher> create(int rank, int size);
+
+  CommStatsPublisher(const std::string& path, CommStatsLayout* layout);
+  ~CommStatsPublisher();
+
+  // Count a new op and return its sequence number.
+  uint64_t recordIssue(int op_type, int64_t bytes);
+
+  void recordCompletion(uint64_t seq,
+                        std::chrono::steady_clock::time_point issue_time,
+                        bool error);
+
+private:
+  template <typename F>
+  void update(F fn);
+
+  std::mutex mutex_;
+  std::string path_;
+  CommStatsLayout* layout_;
+};
+
+} // namespace oneccl_bindings_for_pytorch
@@ -29,7 +29,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <condition_variable>
+#include <cstring>
 #include <deque>
 #include <exception>
 #include <memory>
@@ -41,6 +43,8 @@
 #include <dispatch_stub.h>
 #include <ATen/record_function.h>
 #include "../utils.h"
+#include "../hugepage_allocator.h"
+#include "../custom_reduction.h"
 
 namespace oneccl_bindings_for_pytorch
 {
@@ -109,14 +113,66 @@ public:
 
 };
 
+// Filled by the run() of a sparse encoded op for its postProcess_.
+struct SparseOpState {
+  bool sparse = false;
+  // Kept alive until the op completes.
+  at::Tensor sendBuf;
+  // Encoded shards received from every rank, back to back.
+  at::Tensor encoded;
+  std::vector<int64_t> recvBytes;
+};
+
+// Allgather the `mine.size()` encoded sizes of every rank, so that all ranks
+// know the whole send matrix, with the attributes of the op's payload stage.
+// Waits for the exchange, which has to complete before the payload can be
+// launched, so the works calling it are staged.
+template <typename attr_t>
+std::vector<int64_t> exchangeSparseSizes(const std::vector<int64_t>& mine,
+                                         const attr_t& attr,
+                                         ccl::communicator& comm) {
+  const int world_size = comm.size();
+  std::vector<int64_t> all(world_size * mine.size());
+  std::vector<size_t> recvCounts(world_size, mine.size());
+  auto ag_attr = stage_attr<ccl::allgatherv_attr>(attr);
+  ccl::event evt;
+  call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+    CCL_CHECK(evt = ccl::allgatherv(mine.data(),
+                                    mine.size(),
+                                    all.data(),
+                                    recvCounts,
+                                    ccl::datatype::int64,
+                                    comm,
+                                    ag_attr););
+  });
+  CCL_CHECK(evt.wait());
+  return all;
+}
+
+void checkVarSizeInput(const at::Tensor& input, const char* op) {
+  checkSingleTensorHelper(input);
+  TORCH_CHECK(input.scalar_type() == at::kByte && input.dim() == 1, op, " expects a 1-D uint8 tensor");
+}
+
+// Decode the shard of each rank into the matching chunk of `output`.
+void decodeSparseShards(const SparseOpState& state, const at::Tensor& output) {
+  RECORD_FUNCTION("oneccl_bindings_for_pytorch::cpu::sparse_decode", std::vector<c10::IValue>());
+  const int64_t world_size = state.recvBytes.size();
+  auto chunks = output.view({-1}).chunk(world_size);
+  int64_t offset = 0;
+  for (int64_t r = 0; r < world_size; r++) {
+    sparseDecode(state.encoded.narrow(0, offset, state.recvBytes[r]), chunks[r]);
+    offset += state.recvBytes[r];
+  }
+}
+
 } //namespace anonymous
 
 
 class VanillaCPU final: public DispatchStub {
 public:
 
-  VanillaCPU() {
-    stop_=false;
+  VanillaCPU() : queue_(kWorkQueueCapacity) {
     workerThread_ = std::thread(&VanillaCPU::runLoop, this);
   }
 
@@ -133,6 +189,23 @@ protected:
                                                                     const AllreduceOptions& opts,
                                                                     ProcessGroupCCL& pg) override;
 
+  void allreduce_direct_(at::Tensor& tensor,
+                         const AllreduceOptions& opts,
+                         ProcessGroupCCL& pg) override;
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgatherv_(at::Tensor& input,
+                                                             ProcessGroupCCL& pg) override;
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> broadcast_with_size_(at::Tensor& input,
+                                                                      int64_t root,
+                                  ProcessGroupCCL& pg) override;
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> sendrecv_(at::Tensor& sendTensor,
+                                                           at::Tensor& recvTensor,
+                                                           int dstRank,
+                                                           int srcRank,
+                                                           ProcessGroupCCL& pg) override;
+
 
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> reduce_(std::vector<at::Tensor>& tensors,
                                                          const ReduceOptions& opts,
@@ -162,6 +235,26 @@ protected:
                                                                      const AllgatherOptions& opts,
                                                                      ProcessGroupCCL& pg_ccl) override;
 
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allgather_base_quantized_(at::Tensor& outputTensor,
+                                                                               at::Tensor& inputTensor,
+                                                                               CommQuantType quant,
+                                                                               int64_t block_size,
+                                                                               ProcessGroupCCL& pg_ccl) override;
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_topk_(at::Tensor& tensor,
+                                                                     double ratio,
+                                                                     int64_t key,
+                                                                     ProcessGroupCCL& pg_ccl) override;
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_partial_(at::Tensor& tensor,
+                                                                        bool contribute,
+                                                                        int64_t key,
+                                                                        ProcessGroupCCL& pg_ccl) override;
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_custom_(at::Tensor& tensor,
+                                                                       const std::string& reduction,
+                                                                       ProcessGroupCCL& pg_ccl) override;
+
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> gather_(std::vector<std::vector<at::Tensor>>& outputTensors,
                                                             std::vector<at::Tensor>& inputTensors,
                                                             const GatherOptions& opts,
@@ -186,24 +279,55 @@ protected:
 
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> barrier_(const BarrierOptions& opts,
                                                                 ProcessGroupCCL& pg) override;
+
+  std::shared_ptr<Comms> get_comms_(const at::Device& device, ProcessGroupCCL& pg) override;
   void destroy();
   void reset() override {}
   void runLoop();
+  void submitLoop();
+  // Block until the submission thread has launched every queued work.
+  void waitSubmitDrained();
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> enqueue(c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> & work);
 private:
-  bool stop_;
-  std::mutex pgMutex_;
   std::thread workerThread_;
 
-  std::deque<c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>> queue_;
-  std::condition_variable queueProduceCV_;
-  std::condition_variable queueConsumeCV_;
+  // Works launched on the communicators, completed in order by workerThread_.
+  oneccl_bindings_for_pytorch::MPSCQueue<c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>> queue_;
+
+  // Works of async submit groups and staged works, plus whatever is issued
+  // behind them, launched in FIFO order by submitThread_ so that the order on
+  // each communicator matches the order of the calls.
+  bool submitStop_ = false;
+  bool submitting_ = false;
+  std::once_flag submitThreadFlag_;
+  std::mutex submitMutex_;
+  std::thread submitThread_;
+  std::deque<c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>> submitQueue_;
+  std::condition_variable submitProduceCV_;
+  std::condition_variable submitDrainedCV_;
+
+  void pushCompleted(const c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>& work);
 
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _reduce_oop(at::Tensor& outputTensor,
                                                          at::Tensor& inputTensor,
                                                          const ReduceOptions& opts,
                                                          ProcessGroupCCL& pg_ccl);
 
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_fp32_accum(at::Tensor& tensor,
+                                                                          ProcessGroupCCL& pg_ccl);
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allgather_base_full(at::Tensor& outputTensor,
+                                                                         at::Tensor& inputTensor,
+                                                                         ProcessGroupCCL& pg_ccl);
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allgather_base_sparse(at::Tensor& outputTensor,
+                                                                           at::Tensor& inputTensor,
+                                                                           ProcessGroupCCL& pg_ccl);
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _alltoall_base_sparse(at::Tensor& outputTensor,
+                                                                          at::Tensor& inputTensor,
+                                                                          ProcessGroupCCL& pg_ccl);
+
 };
 
 struct RegisterCPUPMethods {
@@ -248,44 +372,98 @@ std::shared_ptr<cpu_completion_callback<RunF>> make_cpu_callback(RunF f) {
 }
 
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::enqueue(c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> & work) {
-  work->run();
-  std::unique_lock<std::mutex> lock(pgMutex_);
-  queue_.push_back(work);
+  std::unique_lock<std::mutex> lock(submitMutex_);
+  // A work issued while others are still queued for the submission thread
+  // goes behind them, so the order on each communicator stays the order of
+  // the calls.
+  if (work->asyncSubmit_ || work->staged_ || !submitQueue_.empty() || submitting_) {
+    std::call_once(submitThreadFlag_, [this]() {
+      submitThread_ = std::thread(&VanillaCPU::submitLoop, this);
+    });
+    work->launched_.store(false, std::memory_order_relaxed);
+    submitQueue_.push_back(work);
+    lock.unlock();
+    submitProduceCV_.notify_one();
+    return work;
+  }
   lock.unlock();
-  queueProduceCV_.notify_one();
+
+  try {
+    work->run();
+  } catch (...) {
+    // Take the work out of the in-flight bookkeeping before the caller sees
+    // the error.
+    work->finishAsyncWorkCCLError(std::current_exception());
+    work->releaseResources();
+    throw;
+  }
+  pushCompleted(work);
   return work;
 }
 
-void VanillaCPU::destroy() {
-  std::unique_lock<std::mutex> lock(pgMutex_);
-  queueConsumeCV_.wait(lock, [&] { return queue_.empty(); });
-
-  // Queue is empty, signal stop
-  stop_ = true;
+void VanillaCPU::pushCompleted(const c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>& work) {
+  queue_.push(work);
+}
 
-  // Release lock to allow threads to terminate
-  lock.unlock();
-  queueProduceCV_.notify_all();
+void VanillaCPU::submitLoop() {
+  std::unique_lock<std::mutex> lock(submitMutex_);
+  while (true) {
+    submitProduceCV_.wait(lock, [&] { return submitStop_ || !submitQueue_.empty(); });
+    if (submitQueue_.empty()) {
+      return;
+    }
 
-  // Join the single worker thread
-  workerThread_.join();
-}
+    auto work = std::move(submitQueue_.front());
+    submitQueue_.pop_front();
+    submitting_ = true;
+    lock.unlock();
 
-void VanillaCPU::runLoop() {
-  std::unique_lock<std::mutex> lock(pgMutex_);
-  while (!stop_) {
-    if (queue_.empty()) {
-      queueProduceCV_.wait(lock);
-      continue;
+    try {
+      work->run();
+      work->launched_.store(true, std::memory_order_release);
+      pushCompleted(work);
+    } catch (...) {
+      work->launched_.store(true, std::memory_order_release);
+      work->finishAsyncWorkCCLError(std::current_exception());
+      work->releaseResources();
     }
 
-    auto work = std::move(queue_.front());
+    lock.lock();
+    submitting_ = false;
+    if (submitQueue_.empty()) {
+      submitDrainedCV_.notify_all();
+    }
+  }
+}
 
-    queue_.pop_front();
+void VanillaCPU::waitSubmitDrained() {
+  std::unique_lock<std::mutex> lock(submitMutex_);
+  submitDrainedCV_.wait(lock, [&] { return submitQueue_.empty() && !submitting_; });
+}
 
+void VanillaCPU::destroy() {
+  if (submitThread_.joinable()) {
+    std::unique_lock<std::mutex> lock(submitMutex_);
+    submitStop_ = true;
     lock.unlock();
-    queueConsumeCV_.notify_one();
+    submitProduceCV_.notify_all();
+    // The submission thread launches what is left in its queue before it exits.
+    submitThread_.join();
+  }
+
+  // The worker drains the queue before it exits.
+  queue_.close();
 
+  // Join the single worker thread
+  workerThread_.join();
+}
+
+void VanillaCPU::runLoop() {
+  // Callbacks run here may issue collectives while this thread is the one
+  // freeing the in-flight slots.
+  InFlightLimiter::exemptCurrentThread();
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  while (queue_.pop(work)) {
     try {
       work->synchronize();
       work->finishAsyncWorkCCL();
@@ -293,8 +471,11 @@ void VanillaCPU::runLoop() {
     } catch (...) {
       work->finishAsyncWorkCCLError(std::current_exception());
     }
-
-    lock.lock();
+    // The user may hold the work for long after this, e.g. DDP keeps it until
+    // the next iteration, so don't keep the transferred buffers alive with it.
+    work->releaseResources();
+    // Don't hold the last work while parked.
+    work.reset();
   }
 }
 
@@ -303,10 +484,26 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::allreduce_(std::ve
                                                                       ProcessGroupCCL& pg) {
   checkSingleTensor(tensors);
 
+  auto dtype = tensors[0].scalar_type();
+  if (pg.allreduce_fp32_accum_ && opts.reduceOp == c10d::ReduceOp::SUM && pg.getSize() > 1 &&
+      (dtype == at::kBFloat16 || dtype == at::kHalf)) {
+    return _allreduce_fp32_accum(tensors[0], pg);
+  }
+
+  // PREMUL_SUM sums a scaled staging copy into the tensor, out of place.
+  std::vector<at::Tensor> inputs = tensors;
+  ccl::reduction op;
+  if (isPremulSum(opts.reduceOp)) {
+    inputs[0] = tensors[0].mul(premulFactor(opts.reduceOp, tensors[0]));
+    op = ccl::reduction::sum;
+  } else {
+    op = cclOp(opts.reduceOp);
+  }
+
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
   work = collective<get_ccl_comms, CPUWorkCCL>(
           pg,
-          tensors,
+          inputs,
           tensors,
           [=](at::Tensor input,
               at::Tensor output,
@@ -318,7 +515,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::allreduce_(std::ve
                                                      output.data_ptr(),
                                                      (size_t) input.numel(),
                                                      cclDatatypes.at(input.scalar_type()),
-                                                     cclOps.at(opts.reduceOp),
+                                                     op,
                                                      comm,
                                                      attr););
               });
@@ -331,6 +528,275 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::allreduce_(std::ve
   return work;
 }
 
+// Launch and wait on the caller thread, skipping the work, the progress
+// thread and the future. Meant for the small per layer allreduces of decode
+// loops, where those cost as much as the transfer.
+void VanillaCPU::allreduce_direct_(at::Tensor& tensor,
+                                   const AllreduceOptions& opts,
+                                   ProcessGroupCCL& pg) {
+  checkSingleTensorHelper(tensor);
+  TORCH_CHECK(!pg.is_coalescing_, "allreduce_direct cannot be coalesced");
+
+  auto dtype = tensor.scalar_type();
+  if (pg.allreduce_fp32_accum_ && opts.reduceOp == c10d::ReduceOp::SUM && pg.getSize() > 1 &&
+      (dtype == at::kBFloat16 || dtype == at::kHalf)) {
+    DispatchStub::allreduce_direct_(tensor, opts, pg);
+    return;
+  }
+
+  // Keep the launch behind the works still queued for the submission thread.
+  waitSubmitDrained();
+
+  std::vector<at::Device> devices{tensor.device()};
+  auto& comms = get_ccl_comms(pg, get_key_from_devs(devices), devices);
+  auto attr = ccl::create_operation_attr<ccl::allreduce_attr>();
+  if (pg.op_priority_ > 0) {
+    attr.set<ccl::operation_attr_id::priority>(static_cast<size_t>(pg.op_priority_));
+  }
+
+  const int64_t bytes = tensor.numel() * tensor.element_size();
+  const auto issue_time = std::chrono::steady_clock::now();
+  uint64_t stats_seq = pg.commStats_ ? pg.commStats_->recordIssue(static_cast<int>(c10d::OpType::ALLREDUCE), bytes) : 0;
+  uint64_t watchdog_seq = pg.watchdog_ ? pg.watchdog_->recordIssue(static_cast<int>(c10d::OpType::ALLREDUCE),
+                                                                   "allreduce_direct", c10::str(tensor.sizes()),
+                                                                   bytes, issue_time) : 0;
+  auto record_completion = [&](bool error) {
+    if (pg.commStats_) {
+      pg.commStats_->recordCompletion(stats_seq, issue_time, error);
+    }
+    if (pg.watchdog_) {
+      pg.watchdog_->recordCompletion(watchdog_seq);
+    }
+  };
+
+  try {
+    // Only the launch holds the global mutex, the other groups and threads
+    // launch while this one waits.
+    auto reduction = cclOp(opts.reduceOp);
+    ccl::event evt;
+    call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+      CCL_CHECK(evt = ccl::allreduce(tensor.data_ptr(),
+                                     tensor.data_ptr(),
+                                     (size_t) tensor.numel(),
+                                     cclDatatypes.at(dtype),
+                                     reduction,
+                                     comms.comms[0],
+                                     attr););
+    });
+    CCL_CHECK(evt.wait());
+  } catch (...) {
+    record_completion(true);
+    throw;
+  }
+  record_completion(false);
+}
+
+// The int64 sizes are allgathered first, then the payloads go straight into
+// an output of the exact total size. The work is staged: run() waits for the
+// sizes on the submission thread.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::allgatherv_(at::Tensor& input,
+                                                                         ProcessGroupCCL& pg) {
+  checkVarSizeInput(input, "allgatherv");
+  TORCH_CHECK(!pg.is_coalescing_, "allgatherv cannot be coalesced");
+  const int world_size = pg.getSize();
+  auto output = at::empty({0}, input.options());
+  auto sizes = at::empty({world_size}, input.options().dtype(at::kLong));
+
+  std::vector<at::Tensor> inputs{input};
+  std::vector<at::Tensor> outputs{output, sizes};
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor output,
+              ccl::allgatherv_attr attr,
+              ccl::communicator& comm) {
+            const int64_t mine = input.numel();
+            std::vector<size_t> sizeCounts(world_size, 1);
+            ccl::event ret_evt;
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::allgatherv(&mine,
+                                                  1,
+                                                  sizes.data_ptr<int64_t>(),
+                                                  sizeCounts,
+                                                  ccl::datatype::int64,
+                                                  comm,
+                                                  attr));
+            });
+            CCL_CHECK(ret_evt.wait());
+
+            std::vector<size_t> recvCounts(world_size);
+            int64_t total = 0;
+            for (int r = 0; r < world_size; r++) {
+              recvCounts[r] = sizes.data_ptr<int64_t>()[r];
+              total += recvCounts[r];
+            }
+            if (total == 0) {
+              return ret_evt;
+            }
+
+            output.resize_({total});
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::allgatherv(input.data_ptr(),
+                                                  (size_t) mine,
+                                                  output.data_ptr(),
+                                                  recvCounts,
+                                                  ccl::datatype::uint8,
+                                                  comm,
+                                                  attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::ALLGATHER,
+          "oneccl_bindings_for_pytorch::cpu_work::allgatherv");
+
+  work->debugName = std::string("cpu::allgatherv");
+  work->staged_ = true;
+  enqueue(work);
+  return work;
+}
+
+// The root broadcasts the int64 size first, then the payload into an output
+// the receivers allocate from it. Staged like allgatherv_.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::broadcast_with_size_(at::Tensor& input,
+                                                                                  int64_t root,
+                                                                                  ProcessGroupCCL& pg) {
+  checkVarSizeInput(input, "broadcast_with_size");
+  TORCH_CHECK(!pg.is_coalescing_, "broadcast_with_size cannot be coalesced");
+  const bool is_root = pg.getRank() == root;
+  auto output = is_root ? input : at::empty({0}, input.options());
+
+  std::vector<at::Tensor> inputs{input};
+  std::vector<at::Tensor> outputs{output};
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor output,
+              ccl::broadcast_attr attr,
+              ccl::communicator& comm) {
+            int64_t size = input.numel();
+            ccl::event ret_evt;
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::broadcast(&size,
+                                                 1,
+                                                 ccl::datatype::int64,
+                                                 (size_t) root,
+                                                 comm,
+                                                 attr));
+            });
+            CCL_CHECK(ret_evt.wait());
+            if (size == 0) {
+              return ret_evt;
+            }
+
+            if (!is_root) {
+              output.resize_({size});
+            }
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::broadcast(output.data_ptr(),
+                                                 (size_t) size,
+                                                 ccl::datatype::uint8,
+                                                 (size_t) root,
+                                                 comm,
+                                                 attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::BROADCAST,
+          "oneccl_bindings_for_pytorch::cpu_work::broadcast_with_size");
+
+  work->debugName = std::string("cpu::broadcast_with_size");
+  work->staged_ = true;
+  enqueue(work);
+  return work;
+}
+
+// Sum a bf16/fp16 tensor with fp32 accumulation while keeping the reduced
+// precision type on the wire. The reduce_scatter stage is an alltoall of the
+// chunks followed by a local fp32 sum, then the reduced shards are allgathered
+// back into the tensor. Both launches happen in the op's run() so that they
+// keep their place in the communicator's operation order; the work is staged,
+// so run() waits for the alltoall on the submission thread, not the caller.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allreduce_fp32_accum(at::Tensor& tensor,
+                                                                                   ProcessGroupCCL& pg) {
+  const int world_size = pg.getSize();
+  const int64_t numel = tensor.numel();
+  const int64_t chunk = (numel + world_size - 1) / world_size;
+  const bool padded = chunk * world_size != numel;
+
+  auto flat = tensor.view({-1});
+  auto sendBuf = flat;
+  if (padded) {
+    sendBuf = emptyCommBuffer({chunk * world_size}, tensor.options());
+    sendBuf.narrow(0, 0, numel).copy_(flat);
+    sendBuf.narrow(0, numel, chunk * world_size - numel).zero_();
+  }
+  auto recvBuf = emptyCommBuffer({world_size, chunk}, tensor.options());
+  auto shard = emptyCommBuffer({chunk}, tensor.options());
+  auto gathered = padded ? emptyCommBuffer({chunk * world_size}, tensor.options()) : flat;
+
+  std::vector<at::Tensor> inputs{sendBuf};
+  std::vector<at::Tensor> outputs{tensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor /*output*/,
+              ccl::alltoall_attr attr,
+              ccl::communicator& comm) {
+              ccl::event a2a_evt;
+              call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
+                  CCL_CHECK(a2a_evt = ccl::alltoall(input.data_ptr(),
+                                                    recvBuf.data_ptr(),
+                                                    (size_t) chunk,
+                                                    cclDatatypes.at(input.scalar_type()),
+                                                    comm,
+                                                    attr););
+              });
+              CCL_CHECK(a2a_evt.wait());
+
+              auto acc = recvBuf[0].to(at::kFloat);
+              for (int r = 1; r < world_size; r++) {
+                acc.add_(recvBuf[r]);
+              }
+              shard.copy_(acc);
+
+              std::vector<size_t> recvCounts(world_size, chunk);
+              auto ag_attr = stage_attr<ccl::allgatherv_attr>(attr);
+              ccl::event ret_evt;
+              call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
+                  CCL_CHECK(ret_evt = ccl::allgatherv(shard.data_ptr(),
+                                                      (size_t) chunk,
+                                                      gathered.data_ptr(),
+                                                      recvCounts,
+                                                      cclDatatypes.at(shard.scalar_type()),
+                                                      comm,
+                                                      ag_attr););
+              });
+              return ret_evt;
+          },
+          c10d::OpType::ALLREDUCE,
+          "oneccl_bindings_for_pytorch::cpu_work::allreduce_fp32_accum");
+
+  if (padded) {
+    work->postProcess_ = [=]() {
+      flat.copy_(gathered.narrow(0, 0, numel));
+    };
+  }
+  work->debugName = std::string("cpu::allreduce_fp32_accum");
+  work->staged_ = true;
+  enqueue(work);
+  return work;
+}
+
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::allreduce_coalesced_(std::vector<at::Tensor>& tensors,
                                                                 const AllreduceOptions& opts,
                                                                 ProcessGroupCCL& pg) {
@@ -349,7 +815,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::allreduce_coalesce
                                                      output.data_ptr(),
                                                      (size_t) input.numel(),
                                                      cclDatatypes.at(input.scalar_type()),
-                                                     cclOps.at(opts.reduceOp),
+                                                     cclOp(opts.reduceOp),
                                                      comm,
                                                      attr););
               });
@@ -383,7 +849,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::reduce_(std::vecto
                                                   output.data_ptr(),
                                                   (size_t)input.numel(),
                                                   cclDatatypes.at(input.scalar_type()),
-                                                  cclOps.at(opts.reduceOp),
+                                                  cclOp(opts.reduceOp),
                                                   (int)opts.rootRank,
                                                   comm,
                                                   attr););
@@ -422,7 +888,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_reduce_oop(at::Te
                                 output.data_ptr(),
                                 (size_t) input.numel(),
                                 cclDatatypes.at(input.scalar_type()),
-                                cclOps.at(opts.reduceOp),
+                                cclOp(opts.reduceOp),
                                 root,
                                 comm));
       });
@@ -542,6 +1008,21 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allgather_base_(a
                                                                                at::Tensor& inputTensor,
                                                                                const AllgatherOptions& opts,
                                                                                ProcessGroupCCL& pg_ccl) {
+  // Small shards, e.g. metadata and state dict gathers, stay exact.
+  if (pg_ccl.allgather_quant_ != CommQuantType::NONE && at::isFloatingType(inputTensor.scalar_type()) &&
+      static_cast<int64_t>(inputTensor.nbytes()) >= pg_ccl.allgather_quant_min_bytes_) {
+    return _allgather_base_quantized_(outputTensor, inputTensor, pg_ccl.allgather_quant_,
+                                      pg_ccl.allgather_quant_block_, pg_ccl);
+  }
+  if (pg_ccl.sparse_comm_ && pg_ccl.getSize() > 1) {
+    return _allgather_base_sparse(outputTensor, inputTensor, pg_ccl);
+  }
+  return _allgather_base_full(outputTensor, inputTensor, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allgather_base_full(at::Tensor& outputTensor,
+                                                                                   at::Tensor& inputTensor,
+                                                                                   ProcessGroupCCL& pg_ccl) {
   const int world_size = pg_ccl.getSize();
   if (inputTensor.numel() * world_size != outputTensor.numel()) {
     TORCH_CHECK(false, "output tensor size must be equal to world_size times input tensor size");
@@ -582,6 +1063,438 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allgather_base_(a
   return work;
 }
 
+// Each rank encodes its shard with the sparse codec, the encoded sizes are
+// allgathered and then the shards as bytes. Both launches happen in the op's
+// run(), which also falls back to a dense allgather while the group's policy
+// backs off. The work is staged, so the size exchange is waited on the
+// submission thread. The worker thread decodes into the output.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allgather_base_sparse(at::Tensor& outputTensor,
+                                                                                     at::Tensor& inputTensor,
+                                                                                     ProcessGroupCCL& pg_ccl) {
+  checkSingleTensorHelper(inputTensor);
+  checkSingleTensorHelper(outputTensor);
+  const int world_size = pg_ccl.getSize();
+  TORCH_CHECK(inputTensor.numel() * world_size == outputTensor.numel(),
+              "output tensor size must be equal to world_size times input tensor size");
+
+  const int64_t numel = inputTensor.numel();
+  const int64_t elem_size = inputTensor.element_size();
+  auto byte_options = inputTensor.options().dtype(at::kByte);
+  auto policy = pg_ccl.sparse_policy_;
+  auto state = std::make_shared<SparseOpState>();
+
+  auto inputs = std::vector<at::Tensor> {inputTensor};
+  auto outputs = std::vector<at::Tensor> {outputTensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg_ccl,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor output,
+              ccl::allgatherv_attr attr,
+              ccl::communicator& comm) {
+            ccl::event ret_evt;
+            if (!policy->tryNext()) {
+              std::vector<size_t> recvCounts(world_size, numel);
+              call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+                CCL_CHECK(ret_evt = ccl::allgatherv(input.data_ptr(),
+                                                    (size_t) numel,
+                                                    output.data_ptr(),
+                                                    recvCounts,
+                                                    cclDatatypes.at(input.scalar_type()),
+                                                    comm,
+                                                    attr));
+              });
+              return ret_evt;
+            }
+
+            auto encoded = emptyCommBuffer({sparseEncodedBound(numel, elem_size)}, byte_options);
+            const int64_t bytes = sparseEncode(input, encoded);
+            state->recvBytes = exchangeSparseSizes({bytes}, attr, comm);
+            int64_t total = 0;
+            std::vector<size_t> recvCounts(world_size);
+            for (int r = 0; r < world_size; r++) {
+              recvCounts[r] = state->recvBytes[r];
+              total += state->recvBytes[r];
+            }
+            policy->update(total, numel * elem_size * world_size);
+            state->sparse = true;
+            state->sendBuf = encoded;
+            state->encoded = emptyCommBuffer({total}, byte_options);
+
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::allgatherv(encoded.data_ptr(),
+                                                  (size_t) bytes,
+                                                  state->encoded.data_ptr(),
+                                                  recvCounts,
+                                                  ccl::datatype::uint8,
+                                                  comm,
+                                                  attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::_ALLGATHER_BASE,
+          "oneccl_bindings_for_pytorch::cpu_work::_allgather_base_sparse");
+
+  work->postProcess_ = [=]() {
+    if (state->sparse) {
+      decodeSparseShards(*state, outputTensor);
+    }
+  };
+  work->debugName = std::string("cpu::_allgather_base_sparse");
+  work->staged_ = true;
+  enqueue(work);
+  return work;
+}
+
+// Each rank quantizes its shard into [per-block fp32 scales | 8-bit payload],
+// the packed shards are allgathered as bytes and the worker thread dequantizes
+// them into the full precision output before the work is marked completed.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allgather_base_quantized_(at::Tensor& outputTensor,
+                                                                                         at::Tensor& inputTensor,
+                                                                                         CommQuantType quant,
+                                                                                         int64_t block_size,
+                                                                                         ProcessGroupCCL& pg_ccl) {
+  if (quant == CommQuantType::NONE) {
+    return _allgather_base_full(outputTensor, inputTensor, pg_ccl);
+  }
+
+  checkSingleTensorHelper(inputTensor);
+  checkSingleTensorHelper(outputTensor);
+  const int world_size = pg_ccl.getSize();
+  TORCH_CHECK(inputTensor.numel() * world_size == outputTensor.numel(),
+              "output tensor size must be equal to world_size times input tensor size");
+
+  const int64_t numel = inputTensor.numel();
+  const int64_t shard_bytes = quantizedShardBytes(numel, block_size);
+  auto byte_options = inputTensor.options().dtype(at::kByte);
+  auto packedInput = emptyCommBuffer({shard_bytes}, byte_options);
+  auto packedOutput = emptyCommBuffer({shard_bytes * world_size}, byte_options);
+  quantizeBlockwise(inputTensor, packedInput, quant, block_size);
+
+  auto inputs = std::vector<at::Tensor> {packedInput};
+  auto outputs = std::vector<at::Tensor> {outputTensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg_ccl,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor /*output*/,
+              ccl::allgatherv_attr attr,
+              ccl::communicator& comm) {
+            std::vector<size_t> recvCounts(world_size, shard_bytes);
+
+            ccl::event ret_evt;
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::allgatherv(input.data_ptr(),
+                                                  (size_t) shard_bytes,
+                                                  packedOutput.data_ptr(),
+                                                  recvCounts,
+                                                  ccl::datatype::uint8,
+                                                  comm,
+                                                  attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::_ALLGATHER_BASE,
+          "oneccl_bindings_for_pytorch::cpu_work::_allgather_base_quantized");
+
+  work->postProcess_ = [=]() {
+    RECORD_FUNCTION("oneccl_bindings_for_pytorch::cpu::dequantize", std::vector<c10::IValue>());
+    auto flatOutput = outputTensor.view({-1});
+    for (int r = 0; r < world_size; r++) {
+      auto shard = flatOutput.narrow(0, r * numel, numel);
+      dequantizeBlockwise(packedOutput.narrow(0, r * shard_bytes, shard_bytes), shard, quant, block_size);
+    }
+  };
+  work->debugName = std::string("cpu::_allgather_base_quantized");
+  enqueue(work);
+  return work;
+}
+
+// Every rank sends the same number of (index, value) pairs picked from its
+// gradient plus residual, so a plain allgatherv exchanges them and the
+// worker thread sums them into the dense gradient.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allreduce_topk_(at::Tensor& tensor,
+                                                                               double ratio,
+                                                                               int64_t key,
+                                                                               ProcessGroupCCL& pg_ccl) {
+  checkSingleTensorHelper(tensor);
+  TORCH_CHECK(at::isFloatingType(tensor.scalar_type()), "top-k allreduce expects a floating point tensor");
+  const int world_size = pg_ccl.getSize();
+  const int64_t numel = tensor.numel();
+  const int64_t count = topkCount(numel, ratio);
+
+  auto int_options = tensor.options().dtype(at::kInt);
+  auto packedInput = emptyCommBuffer({2 * count}, int_options);
+  auto packedOutput = emptyCommBuffer({2 * count * world_size}, int_options);
+  {
+    // What is not sent stays in the residual for the next steps.
+    RECORD_FUNCTION("oneccl_bindings_for_pytorch::cpu::topk_select", std::vector<c10::IValue>());
+    auto residual = pg_ccl.topk_residuals_->get(key, numel);
+    residual.add_(tensor.view({-1}));
+    int32_t* indices = packedInput.data_ptr<int32_t>();
+    topkSelect(residual.data_ptr<float>(), numel, ratio, indices, reinterpret_cast<float*>(indices + count));
+  }
+
+  auto inputs = std::vector<at::Tensor> {packedInput};
+  auto outputs = std::vector<at::Tensor> {tensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg_ccl,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor /*output*/,
+              ccl::allgatherv_attr attr,
+              ccl::communicator& comm) {
+            std::vector<size_t> recvCounts(world_size, 2 * count);
+
+            ccl::event ret_evt;
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::allgatherv(input.data_ptr(),
+                                                  (size_t) (2 * count),
+                                                  packedOutput.data_ptr(),
+                                                  recvCounts,
+                                                  ccl::datatype::int32,
+                                                  comm,
+                                                  attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::ALLREDUCE,
+          "oneccl_bindings_for_pytorch::cpu_work::_allreduce_topk");
+
+  work->postProcess_ = [=]() {
+    RECORD_FUNCTION("oneccl_bindings_for_pytorch::cpu::topk_merge", std::vector<c10::IValue>());
+    auto merged = tensor.scalar_type() == at::kFloat ? tensor : at::empty(tensor.sizes(), tensor.options().dtype(at::kFloat));
+    merged.zero_();
+    topkMerge(packedOutput.data_ptr<int32_t>(), world_size, numel, ratio, merged.data_ptr<float>());
+    if (!merged.is_same(tensor)) {
+      tensor.copy_(merged);
+    }
+  };
+  work->debugName = std::string("cpu::_allreduce_topk");
+  enqueue(work);
+  return work;
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allreduce_partial_(at::Tensor& tensor,
+                                                                                  bool contribute,
+                                                                                  int64_t key,
+                                                                                  ProcessGroupCCL& pg_ccl) {
+  checkSingleTensorHelper(tensor);
+  TORCH_CHECK(at::isFloatingType(tensor.scalar_type()), "partial allreduce expects a floating point tensor");
+  const int world_size = pg_ccl.getSize();
+  const int64_t numel = tensor.numel();
+
+  // fp32 sum of the contributions followed by one slot per rank, set by the
+  // ranks which contributed, so a single allreduce carries both.
+  auto packed = emptyCommBuffer({numel + world_size}, tensor.options().dtype(at::kFloat));
+  auto payload = packed.narrow(0, 0, numel);
+  auto slots = packed.narrow(0, numel, world_size);
+  slots.zero_();
+  auto residual = pg_ccl.partial_residuals_->get(key, numel);
+  residual.add_(tensor.view({-1}));
+  if (contribute) {
+    payload.copy_(residual);
+    residual.zero_();
+    slots[pg_ccl.getRank()].fill_(1);
+  } else {
+    payload.zero_();
+  }
+
+  auto contributors = at::empty({world_size}, tensor.options().dtype(at::kBool));
+  auto inputs = std::vector<at::Tensor> {packed};
+  auto outputs = std::vector<at::Tensor> {tensor, contributors};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg_ccl,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor /*output*/,
+              ccl::allreduce_attr attr,
+              ccl::communicator& comm) {
+            ccl::event ret_evt;
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(ret_evt = ccl::allreduce(input.data_ptr(),
+                                                 input.data_ptr(),
+                                                 (size_t) input.numel(),
+                                                 ccl::datatype::float32,
+                                                 ccl::reduction::sum,
+                                                 comm,
+                                                 attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::ALLREDUCE,
+          "oneccl_bindings_for_pytorch::cpu_work::_allreduce_partial");
+
+  work->postProcess_ = [=]() {
+    tensor.view({-1}).copy_(payload);
+    contributors.copy_(slots.gt(0.5));
+  };
+  work->debugName = std::string("cpu::_allreduce_partial");
+  enqueue(work);
+  return work;
+}
+
+// Allreduce with a registered reduction, which oneCCL cannot apply itself.
+// Same shape as _allreduce_fp32_accum: an alltoall of the chunks, a local
+// fold of the ranks' chunks in rank order and an allgather of the folded
+// shards, so the traffic matches a ring allreduce and every rank ends up
+// with the same bits. The chunks are whole elements of `width` scalars.
+// Staged like _allreduce_fp32_accum.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_allreduce_custom_(at::Tensor& tensor,
+                                                                                 const std::string& reduction,
+                                                                                 ProcessGroupCCL& pg_ccl) {
+  checkSingleTensorHelper(tensor);
+  TORCH_CHECK(!pg_ccl.is_coalescing_, "_allreduce_custom cannot be coalesced");
+  auto red = getReduction(reduction);
+  TORCH_CHECK(tensor.numel() % red.width == 0,
+              "reduction ", reduction, " works on elements of ", red.width, " scalars, got ", tensor.numel());
+  const int world_size = pg_ccl.getSize();
+  const auto dtype = tensor.scalar_type();
+  const int64_t count = tensor.numel() / red.width;
+  const int64_t chunk = (count + world_size - 1) / world_size;
+  const int64_t chunkBytes = chunk * red.width * tensor.element_size();
+  const bool padded = chunk * world_size != count;
+
+  auto flat = tensor.view({-1});
+  auto sendBuf = flat;
+  if (padded) {
+    // The padding is folded like the rest and dropped afterwards.
+    sendBuf = emptyCommBuffer({chunk * world_size * red.width}, tensor.options());
+    sendBuf.narrow(0, 0, flat.numel()).copy_(flat);
+    sendBuf.narrow(0, flat.numel(), sendBuf.numel() - flat.numel()).zero_();
+  }
+  auto recvBuf = emptyCommBuffer({world_size, chunk * red.width}, tensor.options());
+  auto gathered = padded ? emptyCommBuffer({chunk * world_size * red.width}, tensor.options()) : flat;
+
+  std::vector<at::Tensor> inputs{sendBuf};
+  std::vector<at::Tensor> outputs{tensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg_ccl,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor /*output*/,
+              ccl::alltoall_attr attr,
+              ccl::communicator& comm) {
+              ccl::event a2a_evt;
+              call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
+                  CCL_CHECK(a2a_evt = ccl::alltoall(input.data_ptr(),
+                                                    recvBuf.data_ptr(),
+                                                    (size_t) chunkBytes,
+                                                    ccl::datatype::uint8,
+                                                    comm,
+                                                    attr););
+              });
+              CCL_CHECK(a2a_evt.wait());
+
+              auto shard = recvBuf[0];
+              for (int r = 1; r < world_size; r++) {
+                red.fn(recvBuf[r].data_ptr(), shard.data_ptr(), chunk, dtype);
+              }
+
+              std::vector<size_t> recvCounts(world_size, chunkBytes);
+              auto ag_attr = stage_attr<ccl::allgatherv_attr>(attr);
+              ccl::event ret_evt;
+              call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
+                  CCL_CHECK(ret_evt = ccl::allgatherv(shard.data_ptr(),
+                                                      (size_t) chunkBytes,
+                                                      gathered.data_ptr(),
+                                                      recvCounts,
+                                                      ccl::datatype::uint8,
+                                                      comm,
+                                                      ag_attr););
+              });
+              return ret_evt;
+          },
+          c10d::OpType::ALLREDUCE,
+          "oneccl_bindings_for_pytorch::cpu_work::_allreduce_custom");
+
+  if (padded) {
+    work->postProcess_ = [=]() {
+      flat.copy_(gathered.narrow(0, 0, flat.numel()));
+    };
+  }
+  work->debugName = std::string("cpu::_allreduce_custom");
+  work->staged_ = true;
+  enqueue(work);
+  return work;
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::sendrecv_(at::Tensor& sendTensor,
+                                                                        at::Tensor& recvTensor,
+                                                                        int dstRank,
+                                                                        int srcRank,
+                                                                        ProcessGroupCCL& pg) {
+  const int rank = pg.getRank();
+  // The send is posted before the receive so that both directions are in
+  // flight at once. Its event is kept here and waited for after the receive.
+  struct SendRecvState {
+    ccl::event sendEvt;
+    bool sent = false;
+  };
+  auto state = std::make_shared<SendRecvState>();
+
+  std::vector<at::Tensor> inputs{sendTensor};
+  std::vector<at::Tensor> outputs{recvTensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+          pg,
+          inputs,
+          outputs,
+          [=](at::Tensor input,
+              at::Tensor output,
+              ccl::pt2pt_attr attr,
+              ccl::communicator& comm) {
+            ccl::event ret_evt;
+            if (dstRank == rank && srcRank == rank) {
+              output.copy_(input);
+              return ret_evt;
+            }
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&]() {
+              CCL_CHECK(state->sendEvt = ccl::send(input.data_ptr(),
+                                                   (size_t) input.numel(),
+                                                   cclDatatypes.at(input.scalar_type()),
+                                                   dstRank,
+                                                   comm,
+                                                   attr));
+              state->sent = true;
+              CCL_CHECK(ret_evt = ccl::recv(output.data_ptr(),
+                                            (size_t) output.numel(),
+                                            cclDatatypes.at(output.scalar_type()),
+                                            srcRank,
+                                            comm,
+                                            attr));
+            });
+            return ret_evt;
+          },
+          c10d::OpType::SEND,
+          "oneccl_bindings_for_pytorch::cpu_work::sendrecv");
+
+  work->postProcess_ = [=]() {
+    if (state->sent) {
+      state->sendEvt.wait();
+    }
+  };
+  work->debugName = std::string("cpu::sendrecv");
+  enqueue(work);
+  return work;
+}
+
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::gather_(std::vector<std::vector<at::Tensor>>& outputTensors,
                                                                       std::vector<at::Tensor>& inputTensors,
                                                                       const GatherOptions& opts,
@@ -675,7 +1588,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::reduce_scatter_(st
                                                         output.data_ptr(),
                                                         (size_t) output.numel(),
                                                         cclDatatypes.at(input.scalar_type()),
-                                                        cclOps.at(opts.reduceOp),
+                                                        cclOp(opts.reduceOp),
                                                         comm));
                 });
                 return ret_evt;
@@ -810,7 +1723,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_reduce_scatter_ba
                                                 output.data_ptr(),
                                                 size_t(input.numel()/size),
                                                 cclDatatypes.at(input.scalar_type()),
-                                                cclOps.at(opts.reduceOp),
+                                                cclOp(opts.reduceOp),
                                                 comm,
                                                 attr););
         });
@@ -834,6 +1747,10 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::alltoall_base_(at:
   checkSingleTensorHelper(inputTensor);
   checkSingleTensorHelper(outputTensor);
 
+  if (pg.sparse_comm_ && pg.getSize() > 1 && outputSplitSizes.empty() && inputSplitSizes.empty()) {
+    return _alltoall_base_sparse(outputTensor, inputTensor, pg);
+  }
+
   std::vector<at::Tensor> inputs{inputTensor};
   std::vector<at::Tensor> outputs{outputTensor};
   auto grp_size = pg.getSize();
@@ -918,6 +1835,109 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::alltoall_base_(at:
   return work;
 }
 
+// Equal split alltoall_base with every chunk sparse encoded. Each rank
+// publishes its encoded chunk sizes to all ranks, so that the back off
+// decision of the policy is the same everywhere, then the chunks are
+// exchanged as bytes with alltoallv. Staged like _allgather_base_sparse.
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::_alltoall_base_sparse(at::Tensor& outputTensor,
+                                                                                    at::Tensor& inputTensor,
+                                                                                    ProcessGroupCCL& pg) {
+  const int world_size = pg.getSize();
+  TORCH_CHECK(outputTensor.numel() == inputTensor.numel() &&
+      outputTensor.scalar_type() == inputTensor.scalar_type(),
+      "alltoall_base: tensors are not equal in size or data type");
+  TORCH_CHECK(outputTensor.size(0) % world_size == 0,
+      "alltoall_base: tensor's dim 0 does not divide equally across group size");
+
+  const int64_t numel = inputTensor.numel();
+  const int64_t chunk = numel / world_size;
+  const int64_t elem_size = inputTensor.element_size();
+  auto byte_options = inputTensor.options().dtype(at::kByte);
+  auto policy = pg.sparse_policy_;
+  auto state = std::make_shared<SparseOpState>();
+
+  std::vector<at::Tensor> inputs{inputTensor};
+  std::vector<at::Tensor> outputs{outputTensor};
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  work = collective<get_ccl_comms, CPUWorkCCL>(
+    pg,
+    inputs,
+    outputs,
+    [=](at::Tensor input,
+        at::Tensor output,
+        ccl::alltoallv_attr attr,
+        ccl::communicator& comm) {
+          ccl::event ret_evt;
+          if (!policy->tryNext()) {
+            std::vector<size_t> counts(world_size, chunk);
+            call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
+                CCL_CHECK(ret_evt = ccl::alltoallv(input.data_ptr(),
+                                                   counts,
+                                                   output.data_ptr(),
+                                                   counts,
+                                                   cclDatatypes.at(output.scalar_type()),
+                                                   comm,
+                                                   attr););
+            });
+            return ret_evt;
+          }
+
+          // The chunks are encoded back to back, as alltoallv expects them.
+          auto encoded = emptyCommBuffer({sparseEncodedBound(chunk, elem_size) * world_size}, byte_options);
+          auto src = static_cast<const uint8_t*>(input.data_ptr());
+          std::vector<int64_t> sendBytes(world_size);
+          int64_t offset = 0;
+          for (int r = 0; r < world_size; r++) {
+            sendBytes[r] = sparseEncodeRaw(src + r * chunk * elem_size, chunk, elem_size,
+                                           encoded.data_ptr<uint8_t>() + offset);
+            offset += sendBytes[r];
+          }
+
+          const int rank = comm.rank();
+          auto matrix = exchangeSparseSizes(sendBytes, attr, comm);
+          std::vector<size_t> sendCounts(sendBytes.begin(), sendBytes.end());
+          std::vector<size_t> recvCounts(world_size);
+          state->recvBytes.resize(world_size);
+          int64_t total = 0, received = 0;
+          for (int r = 0; r < world_size; r++) {
+            state->recvBytes[r] = matrix[r * world_size + rank];
+            recvCounts[r] = state->recvBytes[r];
+            received += state->recvBytes[r];
+            for (int c = 0; c < world_size; c++) {
+              total += matrix[r * world_size + c];
+            }
+          }
+          policy->update(total, numel * elem_size * world_size);
+          state->sparse = true;
+          state->sendBuf = encoded;
+          state->encoded = emptyCommBuffer({received}, byte_options);
+
+          call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
+              CCL_CHECK(ret_evt = ccl::alltoallv(encoded.data_ptr(),
+                                                 sendCounts,
+                                                 state->encoded.data_ptr(),
+                                                 recvCounts,
+                                                 ccl::datatype::uint8,
+                                                 comm,
+                                                 attr););
+          });
+          return ret_evt;
+    },
+    c10d::OpType::ALLTOALL_BASE,
+    "oneccl_bindings_for_pytorch::cpu_work::alltoall_base_sparse");
+
+  work->postProcess_ = [=]() {
+    if (state->sparse) {
+      decodeSparseShards(*state, outputTensor);
+    }
+  };
+  work->debugName = std::string("cpu::alltoall_base_sparse");
+  work->staged_ = true;
+  enqueue(work);
+  return work;
+}
+
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::alltoall_(std::vector<at::Tensor>& outputTensors,
                                                              std::vector<at::Tensor>& inputTensors,
                                                              const AllToAllOptions& opts,
@@ -1009,6 +2029,10 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::barrier_(const Bar
 
   c10::intrusive_ptr<AsyncBarrierWork> work = c10::make_intrusive<AsyncBarrierWork>();
 
+  // The barrier is launched here, so it has to come after the works still
+  // queued for the submission thread on the same communicators.
+  waitSubmitDrained();
+
   if (pg.ccl_member_->ccl_comms.size() == 0) {
     std::vector<at::Device> cpu_devices{at::Device("cpu")};
     const auto key = get_key_from_devs(cpu_devices);
@@ -1033,6 +2057,12 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> VanillaCPU::barrier_(const Bar
   return work;
 }
 
+std::shared_ptr<Comms> VanillaCPU::get_comms_(const at::Device& device, ProcessGroupCCL& pg) {
+  const auto key = get_key_from_devs({device});
+  get_ccl_comms(pg, key, {device});
+  return pg.ccl_member_->get_comms(key);
+}
+
 
 RegisterCPUPMethods cpu_register;
 
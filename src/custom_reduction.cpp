@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "custom_reduction.h"
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <type_traits>
+
+#include <ATen/Dispatch.h>
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+template <typename scalar_t>
+using acc_type_t = typename std::conditional<std::is_same<scalar_t, double>::value, double, float>::type;
+
+// log(exp(a) + exp(b)) without overflow, e.g. to merge the softmax
+// denominators of attention blocks.
+void logSumExp(const void* in, void* inout, int64_t count, at::ScalarType dtype) {
+  AT_DISPATCH_FLOATING_TYPES_AND2(at::kBFloat16, at::kHalf, dtype, "logsumexp", [&] {
+    using acc_t = acc_type_t<scalar_t>;
+    auto src = static_cast<const scalar_t*>(in);
+    auto dst = static_cast<scalar_t*>(inout);
+    for (int64_t i = 0; i < count; i++) {
+      acc_t a = static_cast<acc_t>(dst[i]);
+      acc_t b = static_cast<acc_t>(src[i]);
+      acc_t hi = std::max(a, b);
+      if (hi == -std::numeric_limits<acc_t>::infinity()) {
+        continue;
+      }
+      dst[i] = static_cast<scalar_t>(hi + std::log1p(std::exp(std::min(a, b) - hi)));
+    }
+  });
+}
+
+// Compensated sums (s, c), standing for s + c. The rounding error of s1 + s2
+// goes to the compensation, which is folded back into the sum at the end.
+void kahanSum(const void* in, void* inout, int64_t count, at::ScalarType dtype) {
+  AT_DISPATCH_FLOATING_TYPES_AND2(at::kBFloat16, at::kHalf, dtype, "kahan_sum", [&] {
+    using acc_t = acc_type_t<scalar_t>;
+    auto src = static_cast<const scalar_t*>(in);
+    auto dst = static_cast<scalar_t*>(inout);
+    for (int64_t i = 0; i < count; i++) {
+      acc_t s1 = static_cast<acc_t>(dst[2 * i]), c1 = static_cast<acc_t>(dst[2 * i + 1]);
+      acc_t s2 = static_cast<acc_t>(src[2 * i]), c2 = static_cast<acc_t>(src[2 * i + 1]);
+      acc_t s = s1 + s2;
+      acc_t bp = s - s1;
+      acc_t c = c1 + c2 + ((s1 - (s - bp)) + (s2 - bp));
+      scalar_t t = static_cast<scalar_t>(s + c);
+      dst[2 * i] = t;
+      dst[2 * i + 1] = static_cast<scalar_t>(c - (static_cast<acc_t>(t) - s));
+    }
+  });
+}
+
+// (value, index) pairs, keeping the larger value and the lower index on ties.
+void maxWithIndex(const void* in, void* inout, int64_t count, at::ScalarType dtype) {
+  AT_DISPATCH_ALL_TYPES_AND2(at::kBFloat16, at::kHalf, dtype, "max_with_index", [&] {
+    auto src = static_cast<const scalar_t*>(in);
+    auto dst = static_cast<scalar_t*>(inout);
+    for (int64_t i = 0; i < count; i++) {
+      const scalar_t* a = dst + 2 * i;
+      const scalar_t* b = src + 2 * i;
+      if (b[0] > a[0] || (b[0] == a[0] && b[1] < a[1])) {
+        dst[2 * i] = b[0];
+        dst[2 * i + 1] = b[1];
+      }
+    }
+  });
+}
+
+struct Registry {
+  std::mutex mutex;
+  std::map<std::string, CustomReduction> reductions{
+      {"logsumexp", {logSumExp, 1}},
+      {"kahan_sum", {kahanSum, 2}},
+      {"max_with_index", {maxWithIndex, 2}},
+  };
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+} // namespace
+
+void registerReduction(const std::string& name, ReductionFn fn, int64_t width) {
+  TORCH_CHECK(fn, "registerReduction: empty function for ", name);
+  TORCH_CHECK(width > 0, "registerReduction: width has to be positive, got ", width);
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.reductions[name] = CustomReduction{std::move(fn), width};
+}
+
+CustomReduction getReduction(const std::string& name) {
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  auto it = reg.reductions.find(name);
+  TORCH_CHECK(it != reg.reductions.end(), "unknown custom reduction ", name);
+  return it->second;
+}
+
+std::vector<std::string> reductionNames() {
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::vector<std::string> names;
+  for (const auto& entry : reg.reductions) {
+    names.push_back(entry.first);
+  }
+  return names;
+}
+
+} // namespace oneccl_bindings_for_pytorch
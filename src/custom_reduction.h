@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <ATen/ATen.h>
+
+// Named elementwise reductions beyond the SUM/PRODUCT/MIN/MAX oneCCL runs
+// itself, applied by ProcessGroupCCL::_allreduce_custom. C++ extensions
+// linking liboneccl_bindings_for_pytorch.so register their own.
+namespace oneccl_bindings_for_pytorch {
+
+// Folds `count` elements of `in` into `inout`, i.e. inout = inout op in. An
+// element is `width` consecutive scalars of `dtype`, e.g. a value and its
+// index. Throws for a dtype it does not handle. Has to be associative, the
+// ranks' contributions are folded in rank order.
+using ReductionFn = std::function<void(const void* in, void* inout, int64_t count, at::ScalarType dtype)>;
+
+struct CustomReduction {
+  ReductionFn fn;
+  int64_t width = 1;
+};
+
+// Registers or replaces `name`. Every rank has to register the same
+// reductions under the same names.
+void registerReduction(const std::string& name, ReductionFn fn, int64_t width = 1);
+
+// Throws for names which were not registered.
+CustomReduction getReduction(const std::string& name);
+
+// Registered names, starting with the built-in "logsumexp", "kahan_sum"
+// (width 2: sum and compensation) and "max_with_index" (width 2: value and
+// index, ties going to the lower index).
+std::vector<std::string> reductionNames();
+
+} // namespace oneccl_bindings_for_pytorch
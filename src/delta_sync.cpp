@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <ATen/Parallel.h>
+#include <c10/util/Exception.h>
+
+#include "delta_sync.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+// Blocks handled by one intra-op task.
+constexpr int64_t kDeltaGrainBlocks = 4;
+
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9ull;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ull;
+
+inline uint64_t rotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t mixWord(uint64_t acc, uint64_t word) {
+  return rotl(acc + word * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t loadWord(const uint8_t* p) {
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// xxHash64 style hash with four independent lanes, so that hashing runs
+// close to memory bandwidth.
+uint64_t hashBlock(const uint8_t* p, int64_t len) {
+  uint64_t acc[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+  int64_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    for (int lane = 0; lane < 4; lane++) {
+      acc[lane] = mixWord(acc[lane], loadWord(p + i + lane * 8));
+    }
+  }
+  uint64_t h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+  for (; i < len; i += 8) {
+    uint64_t word = 0;
+    std::memcpy(&word, p + i, std::min<int64_t>(8, len - i));
+    h = rotl(h ^ mixWord(0, word), 27) * kPrime1 + kPrime4;
+  }
+  h ^= static_cast<uint64_t>(len);
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+int64_t numBlocks(int64_t nbytes, int64_t block_bytes) {
+  return (nbytes + block_bytes - 1) / block_bytes;
+}
+
+int64_t blockLen(int64_t nbytes, int64_t block_bytes, int64_t b) {
+  return std::min(block_bytes, nbytes - b * block_bytes);
+}
+
+void checkDeltaTensor(const at::Tensor& tensor, int64_t block_bytes) {
+  TORCH_CHECK(tensor.is_contiguous() && tensor.device().is_cpu(), "delta sync: expects a contiguous CPU tensor");
+  TORCH_CHECK(block_bytes > 0 && block_bytes % 8 == 0, "delta sync: block size must be a positive multiple of 8");
+}
+
+// Checks that `blocks` are ascending block indices of `nbytes` bytes, which
+// makes every block but the last packed one full sized.
+int64_t packedBytes(const at::Tensor& blocks, int64_t nbytes, int64_t block_bytes) {
+  TORCH_CHECK(blocks.is_contiguous() && blocks.scalar_type() == at::kLong, "delta sync: expects int64 block indices");
+  const int64_t nblocks = numBlocks(nbytes, block_bytes);
+  const int64_t* idx = blocks.data_ptr<int64_t>();
+  int64_t total = 0;
+  for (int64_t k = 0; k < blocks.numel(); k++) {
+    TORCH_CHECK(idx[k] >= 0 && idx[k] < nblocks && (k == 0 || idx[k] > idx[k - 1]),
+                "delta sync: block indices must be ascending and in range");
+    total += blockLen(nbytes, block_bytes, idx[k]);
+  }
+  return total;
+}
+
+} // namespace
+
+at::Tensor deltaBlockHashes(const at::Tensor& tensor, int64_t block_bytes) {
+  checkDeltaTensor(tensor, block_bytes);
+  const int64_t nbytes = tensor.nbytes();
+  const auto* src = static_cast<const uint8_t*>(tensor.data_ptr());
+  auto hashes = at::empty({numBlocks(nbytes, block_bytes)}, tensor.options().dtype(at::kLong));
+  auto* out = hashes.data_ptr<int64_t>();
+  at::parallel_for(0, hashes.numel(), kDeltaGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; b++) {
+      out[b] = static_cast<int64_t>(hashBlock(src + b * block_bytes, blockLen(nbytes, block_bytes, b)));
+    }
+  });
+  return hashes;
+}
+
+at::Tensor deltaChangedBlocks(const at::Tensor& tensor, const at::Tensor& base, int64_t block_bytes) {
+  checkDeltaTensor(tensor, block_bytes);
+  checkDeltaTensor(base, block_bytes);
+  TORCH_CHECK(tensor.nbytes() == base.nbytes(), "delta sync: tensor and base differ in size");
+  const int64_t nbytes = tensor.nbytes();
+  const int64_t nblocks = numBlocks(nbytes, block_bytes);
+  const auto* a = static_cast<const uint8_t*>(tensor.data_ptr());
+  const auto* b = static_cast<const uint8_t*>(base.data_ptr());
+  std::vector<uint8_t> changed(nblocks);
+  at::parallel_for(0, nblocks, kDeltaGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      changed[i] = std::memcmp(a + i * block_bytes, b + i * block_bytes, blockLen(nbytes, block_bytes, i)) != 0;
+    }
+  });
+  std::vector<int64_t> idx;
+  for (int64_t i = 0; i < nblocks; i++) {
+    if (changed[i]) {
+      idx.push_back(i);
+    }
+  }
+  auto blocks = at::empty({static_cast<int64_t>(idx.size())}, tensor.options().dtype(at::kLong));
+  if (!idx.empty()) {
+    std::memcpy(blocks.data_ptr<int64_t>(), idx.data(), idx.size() * sizeof(int64_t));
+  }
+  return blocks;
+}
+
+at::Tensor deltaGatherBlocks(const at::Tensor& tensor, const at::Tensor& blocks, int64_t block_bytes,
+                             const at::Tensor& base) {
+  checkDeltaTensor(tensor, block_bytes);
+  const int64_t nbytes = tensor.nbytes();
+  auto payload = at::empty({packedBytes(blocks, nbytes, block_bytes)}, tensor.options().dtype(at::kByte));
+  const auto* src = static_cast<const uint8_t*>(tensor.data_ptr());
+  uint8_t* prev = nullptr;
+  if (base.defined()) {
+    checkDeltaTensor(base, block_bytes);
+    TORCH_CHECK(base.nbytes() == tensor.nbytes(), "delta sync: tensor and base differ in size");
+    prev = static_cast<uint8_t*>(base.data_ptr());
+  }
+  const int64_t* idx = blocks.data_ptr<int64_t>();
+  uint8_t* out = payload.data_ptr<uint8_t>();
+  at::parallel_for(0, blocks.numel(), kDeltaGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t k = begin; k < end; k++) {
+      const int64_t offset = idx[k] * block_bytes;
+      const int64_t len = blockLen(nbytes, block_bytes, idx[k]);
+      uint8_t* dst = out + k * block_bytes;
+      if (prev) {
+        for (int64_t i = 0; i < len; i++) {
+          dst[i] = src[offset + i] ^ prev[offset + i];
+        }
+        std::memcpy(prev + offset, src + offset, len);
+      } else {
+        std::memcpy(dst, src + offset, len);
+      }
+    }
+  });
+  return payload;
+}
+
+void deltaScatterBlocks(at::Tensor& tensor, const at::Tensor& blocks, const at::Tensor& payload,
+                        int64_t block_bytes, bool xor_payload) {
+  checkDeltaTensor(tensor, block_bytes);
+  const int64_t nbytes = tensor.nbytes();
+  TORCH_CHECK(payload.is_contiguous() && payload.scalar_type() == at::kByte &&
+              payload.numel() == packedBytes(blocks, nbytes, block_bytes),
+              "delta sync: payload does not match the block indices");
+  auto* dst = static_cast<uint8_t*>(tensor.data_ptr());
+  const int64_t* idx = blocks.data_ptr<int64_t>();
+  const uint8_t* in = payload.data_ptr<uint8_t>();
+  at::parallel_for(0, blocks.numel(), kDeltaGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t k = begin; k < end; k++) {
+      const int64_t offset = idx[k] * block_bytes;
+      const int64_t len = blockLen(nbytes, block_bytes, idx[k]);
+      const uint8_t* src = in + k * block_bytes;
+      if (xor_payload) {
+        for (int64_t i = 0; i < len; i++) {
+          dst[offset + i] ^= src[i];
+        }
+      } else {
+        std::memcpy(dst + offset, src, len);
+      }
+    }
+  });
+}
+
+} // namespace oneccl_bindings_for_pytorch
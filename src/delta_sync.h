@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <ATen/ATen.h>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Block level change tracking of a contiguous tensor which is broadcast over
+// and over while changing little, e.g. weights pushed from trainer ranks to
+// inference ranks. The tensor's bytes are split in blocks of `block_bytes`,
+// the last one may be shorter. `block_bytes` is a multiple of 8.
+
+// 64-bit hash of every block, as an int64 tensor.
+at::Tensor deltaBlockHashes(const at::Tensor& tensor, int64_t block_bytes);
+
+// Indices of the blocks in which `tensor` and `base` differ, as an int64 tensor.
+at::Tensor deltaChangedBlocks(const at::Tensor& tensor, const at::Tensor& base, int64_t block_bytes);
+
+// Packs the ascending `blocks` of `tensor` back to back into a uint8 tensor.
+// With a defined `base`, packs `tensor` XOR `base` instead, so that unchanged
+// elements come out as zeros, and then copies the blocks into `base`.
+at::Tensor deltaGatherBlocks(const at::Tensor& tensor, const at::Tensor& blocks, int64_t block_bytes,
+                             const at::Tensor& base);
+
+// Writes the blocks packed by deltaGatherBlocks back into `tensor`, XORing
+// them into it when `xor_payload` is set.
+void deltaScatterBlocks(at::Tensor& tensor, const at::Tensor& blocks, const at::Tensor& payload,
+                        int64_t block_bytes, bool xor_payload);
+
+} // namespace oneccl_bindings_for_pytorch
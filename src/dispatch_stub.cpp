@@ -118,6 +118,92 @@ protected:
     return work;
   }
 
+  void allreduce_direct_(at::Tensor& tensor,
+                         const AllreduceOptions& opts,
+                         ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::allreduce_direct: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " ";
+    format_tensors_size(os, tensor);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    hdlr->allreduce_direct_(tensor, opts, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+  }
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgatherv_(at::Tensor& input,
+                                                             ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::allgatherv: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " input ";
+    format_tensors_size(os, input);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->allgatherv_(input, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> broadcast_with_size_(at::Tensor& input,
+                                                                      int64_t root,
+                                                                      ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::broadcast_with_size: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " root " << root << " input ";
+    format_tensors_size(os, input);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->broadcast_with_size_(input, root, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> sendrecv_(at::Tensor& sendTensor,
+                                                           at::Tensor& recvTensor,
+                                                           int dstRank,
+                                                           int srcRank,
+                                                           ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::sendrecv: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " dst " << dstRank << " src " << srcRank << " send ";
+    format_tensors_size(os, sendTensor);
+    os << " recv ";
+    format_tensors_size(os, recvTensor);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->sendrecv_(sendTensor, recvTensor, dstRank, srcRank, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allreduce_coalesced_(std::vector<at::Tensor>& tensors,
                                                             const AllreduceOptions& opts,
                                                             ProcessGroupCCL& pg_ccl) override {
@@ -307,6 +393,97 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> reduce_scatter_tensor_coalesce
     return work;
   }
 
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allgather_base_quantized_(at::Tensor& outputTensor,
+                                                                at::Tensor& inputTensor,
+                                                                CommQuantType quant,
+                                                                int64_t block_size,
+                                                                ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::_allgather_base_quantized: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " " << commQuantTypeName(quant) << "/" << block_size;
+    os << " input ";
+    format_tensors_size(os, inputTensor);
+    os << " output ";
+    format_tensors_size(os, outputTensor);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->_allgather_base_quantized_(outputTensor, inputTensor, quant, block_size, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_topk_(at::Tensor& tensor,
+                                                                double ratio,
+                                                                int64_t key,
+                                                                ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::_allreduce_topk: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " ratio " << ratio << " key " << key << " ";
+    format_tensors_size(os, tensor);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->_allreduce_topk_(tensor, ratio, key, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_partial_(at::Tensor& tensor,
+                                                                    bool contribute,
+                                                                    int64_t key,
+                                                                    ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::_allreduce_partial: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " contribute " << contribute << " key " << key << " ";
+    format_tensors_size(os, tensor);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->_allreduce_partial_(tensor, contribute, key, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_custom_(at::Tensor& tensor,
+                                                                   const std::string& reduction,
+                                                                   ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::_allreduce_custom: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " reduction " << reduction << " ";
+    format_tensors_size(os, tensor);
+    std::cout << os.str() << std::endl;
+
+    auto workStartTime_ = std::chrono::steady_clock::now();
+    auto work = hdlr->_allreduce_custom_(tensor, reduction, pg_ccl);
+    auto currentTimepoint = std::chrono::steady_clock::now();
+    auto timeElapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        currentTimepoint - workStartTime_);
+    format_time_elapsed(os, timeElapsed);
+    std::cout << os.str() << std::endl;
+    return work;
+  }
+
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgather_into_tensor_coalesced_(
                                                         std::vector<at::Tensor>& outputTensors,
                                                         std::vector<at::Tensor>& inputTensors,
@@ -512,6 +689,15 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> reduce_scatter_tensor_coalesce
     return get_ccl_stub(c10::DeviceType::XPU)->end_coalescing_(pg_ccl);
   }
 
+  std::shared_ptr<Comms> get_comms_(const at::Device& device, ProcessGroupCCL& pg_ccl) override {
+    std::stringstream os;
+    os << "oneccl_bindings_for_pytorch::" << dev_type << "::get_comms: ";
+    format_pg_rank_with_number(os, pg_ccl, ccl_primitive_number++);
+    os << " device " << device;
+    std::cout << os.str() << std::endl;
+    return hdlr->get_comms_(device, pg_ccl);
+  }
+
 private:
   c10::DeviceType dev_type;
   DispatchStub* hdlr;
@@ -557,6 +743,36 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::allreduce(std::v
   return get_ccl_stub(dev_type)->allreduce_(tensors, opts, pg_ccl);
 }
 
+void DispatchStub::allreduce_direct(at::Tensor& tensor,
+                                    const AllreduceOptions& opts,
+                                    ProcessGroupCCL& pg_ccl) {
+  c10::DeviceType dev_type = tensor.device().type();
+  get_ccl_stub(dev_type)->allreduce_direct_(tensor, opts, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::allgatherv(at::Tensor& input,
+                                                                        ProcessGroupCCL& pg_ccl) {
+  c10::DeviceType dev_type = input.device().type();
+  return get_ccl_stub(dev_type)->allgatherv_(input, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::broadcast_with_size(at::Tensor& input,
+                                                                                 int64_t root,
+                                                                                 ProcessGroupCCL& pg_ccl) {
+  c10::DeviceType dev_type = input.device().type();
+  return get_ccl_stub(dev_type)->broadcast_with_size_(input, root, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::sendrecv(at::Tensor& sendTensor,
+                                                                      at::Tensor& recvTensor,
+                                                                      int dstRank,
+                                                                      int srcRank,
+                                                                      ProcessGroupCCL& pg_ccl) {
+  checkSameType(sendTensor, std::vector<at::Tensor>{recvTensor});
+  c10::DeviceType dev_type = sendTensor.device().type();
+  return get_ccl_stub(dev_type)->sendrecv_(sendTensor, recvTensor, dstRank, srcRank, pg_ccl);
+}
+
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::allreduce_coalesced(std::vector<at::Tensor>& tensors,
                                                                        const AllreduceOptions& opts,
                                                                        ProcessGroupCCL& pg_ccl) {
@@ -602,6 +818,43 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::_allgather_base(
   return get_ccl_stub(dev_type)->_allgather_base_(outputTensor, inputTensor, opts, pg_ccl);
 }
 
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::_allgather_base_quantized(
+                                                                at::Tensor& outputTensor,
+                                                                at::Tensor& inputTensor,
+                                                                CommQuantType quant,
+                                                                int64_t block_size,
+                                                                ProcessGroupCCL& pg_ccl) {
+  checkSameType(inputTensor, std::vector{outputTensor});
+  c10::DeviceType dev_type = inputTensor.device().type();
+  return get_ccl_stub(dev_type)->_allgather_base_quantized_(outputTensor, inputTensor, quant, block_size, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::_allreduce_topk(
+                                                                at::Tensor& tensor,
+                                                                double ratio,
+                                                                int64_t key,
+                                                                ProcessGroupCCL& pg_ccl) {
+  c10::DeviceType dev_type = tensor.device().type();
+  return get_ccl_stub(dev_type)->_allreduce_topk_(tensor, ratio, key, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::_allreduce_partial(
+                                                                at::Tensor& tensor,
+                                                                bool contribute,
+                                                                int64_t key,
+                                                                ProcessGroupCCL& pg_ccl) {
+  c10::DeviceType dev_type = tensor.device().type();
+  return get_ccl_stub(dev_type)->_allreduce_partial_(tensor, contribute, key, pg_ccl);
+}
+
+c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::_allreduce_custom(
+                                                                at::Tensor& tensor,
+                                                                const std::string& reduction,
+                                                                ProcessGroupCCL& pg_ccl) {
+  c10::DeviceType dev_type = tensor.device().type();
+  return get_ccl_stub(dev_type)->_allreduce_custom_(tensor, reduction, pg_ccl);
+}
+
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::allgather_into_tensor_coalesced(
                                                             std::vector<at::Tensor>& outputTensors,
                                                             std::vector<at::Tensor>& inputTensors,
@@ -713,6 +966,10 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> DispatchStub::end_coalescing(P
     return get_ccl_stub(c10::DeviceType::XPU)->end_coalescing_(pg_ccl);
 }
 
+std::shared_ptr<Comms> DispatchStub::get_comms(const at::Device& device, ProcessGroupCCL& pg_ccl) {
+  return get_ccl_stub(device.type())->get_comms_(device, pg_ccl);
+}
+
 void DispatchStub::reset_all() {
   auto dispatch_stubs = get_dispatch_stub();
   for(auto stub: dispatch_stubs) {
@@ -55,6 +55,30 @@ public:
                                                                   const AllreduceOptions& opts,
                                                                   ProcessGroupCCL& pg_ccl);
 
+  // In-place allreduce which returns once it has completed, without a work.
+  static void allreduce_direct(at::Tensor& tensor,
+                               const AllreduceOptions& opts,
+                               ProcessGroupCCL& pg_ccl);
+
+  // Allgather of 1-D uint8 tensors of any size. The work's result is the
+  // payloads back to back and the int64 size of each rank's.
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgatherv(at::Tensor& input,
+                                                                   ProcessGroupCCL& pg_ccl);
+
+  // Broadcast of a 1-D uint8 tensor whose size only the root knows. The
+  // work's result is the broadcast tensor.
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> broadcast_with_size(at::Tensor& input,
+                                                                            int64_t root,
+                                                                            ProcessGroupCCL& pg_ccl);
+
+  // Sends `sendTensor` to `dstRank` while receiving `recvTensor` from
+  // `srcRank`, as one work.
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> sendrecv(at::Tensor& sendTensor,
+                                                                 at::Tensor& recvTensor,
+                                                                 int dstRank,
+                                                                 int srcRank,
+                                                                 ProcessGroupCCL& pg_ccl);
+
   static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> reduce(std::vector<at::Tensor>& tensors,
                                                                const ReduceOptions& opts,
                                                                ProcessGroupCCL& pg_ccl);
@@ -74,6 +98,30 @@ public:
                                                                 const AllgatherOptions& opts,
                                                                 ProcessGroupCCL& pg_ccl);
 
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allgather_base_quantized(
+                                                                at::Tensor& outputBuffer,
+                                                                at::Tensor& inputBuffer,
+                                                                CommQuantType quant,
+                                                                int64_t block_size,
+                                                                ProcessGroupCCL& pg_ccl);
+
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_topk(
+                                                                at::Tensor& tensor,
+                                                                double ratio,
+                                                                int64_t key,
+                                                                ProcessGroupCCL& pg_ccl);
+
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_partial(
+                                                                at::Tensor& tensor,
+                                                                bool contribute,
+                                                                int64_t key,
+                                                                ProcessGroupCCL& pg_ccl);
+
+  static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_custom(
+                                                                at::Tensor& tensor,
+                                                                const std::string& reduction,
+                                                                ProcessGroupCCL& pg_ccl);
+
   static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgather_into_tensor_coalesced(
                                                                 std::vector<at::Tensor>& outputTensors,
                                                                 std::vector<at::Tensor>& inputTensors,
@@ -132,6 +180,9 @@ public:
 
   static c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> end_coalescing(ProcessGroupCCL& pg_ccl);                                                            
 
+  // The cached communicators of the group for `device`, created on first use.
+  static std::shared_ptr<Comms> get_comms(const at::Device& device, ProcessGroupCCL& pg_ccl);
+
   static void reset_all();
 
   virtual ~DispatchStub() {};
@@ -167,6 +218,42 @@ public:
       return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
   }
 
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allgather_base_quantized_(at::Tensor& outputTensor,
+                                                                        at::Tensor& inputTensor,
+                                                                        CommQuantType quant,
+                                                                        int64_t block_size,
+                                                                        ProcessGroupCCL& pg_ccl)  {
+
+      fail(inputTensor.device().type(), "_allgather_base_quantized");
+      return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_topk_(at::Tensor& tensor,
+                                                                        double ratio,
+                                                                        int64_t key,
+                                                                        ProcessGroupCCL& pg_ccl)  {
+
+      fail(tensor.device().type(), "_allreduce_topk");
+      return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_partial_(at::Tensor& tensor,
+                                                                        bool contribute,
+                                                                        int64_t key,
+                                                                        ProcessGroupCCL& pg_ccl)  {
+
+      fail(tensor.device().type(), "_allreduce_partial");
+      return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> _allreduce_custom_(at::Tensor& tensor,
+                                                                       const std::string& reduction,
+                                                                       ProcessGroupCCL& pg_ccl)  {
+
+      fail(tensor.device().type(), "_allreduce_custom");
+      return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
   virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgather_into_tensor_coalesced_(std::vector<at::Tensor>& outputTensors,
                                                                         std::vector<at::Tensor>& inputTensors,
                                                                         const AllgatherOptions& opts,
@@ -263,6 +350,36 @@ public:
     return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
   }
 
+  // Devices without a direct path wait on a regular allreduce.
+  virtual void allreduce_direct_(at::Tensor& tensor,
+                                 const AllreduceOptions& opts,
+                                 ProcessGroupCCL& pg_ccl) {
+    std::vector<at::Tensor> tensors{tensor};
+    allreduce_(tensors, opts, pg_ccl)->wait();
+  }
+
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allgatherv_(at::Tensor& input,
+                                                                     ProcessGroupCCL& pg_ccl) {
+    fail(input.device().type(), "allgatherv");
+    return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> broadcast_with_size_(at::Tensor& input,
+                                                                              int64_t root,
+                                                                              ProcessGroupCCL& pg_ccl) {
+    fail(input.device().type(), "broadcast_with_size");
+    return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
+  virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> sendrecv_(at::Tensor& sendTensor,
+                                                                   at::Tensor& recvTensor,
+                                                                   int dstRank,
+                                                                   int srcRank,
+                                                                   ProcessGroupCCL& pg_ccl) {
+    fail(sendTensor.device().type(), "sendrecv");
+    return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
+  }
+
   virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> send_(std::vector<at::Tensor>& tensors,
                                                                 int dstRank,
                                                                 int tag,
@@ -284,6 +401,11 @@ public:
     return c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>();
   }
 
+  virtual std::shared_ptr<Comms> get_comms_(const at::Device& device, ProcessGroupCCL& pg_ccl) {
+    fail(device.type(), "get_comms");
+    return nullptr;
+  }
+
 private:
   static void fail(c10::DeviceType dev_type, const std::string method) {
     TORCH_CHECK(false, "oneccl_bindings_for_pytorch: ", method, " isn't implementd on backend [", dev_type, "].");
@@ -35,8 +35,12 @@
 #include <ipex.h>
 
 #include <sycl/sycl.hpp>
+// The ESIMD allreduce kernels and their Level-Zero IPC exchange only run on
+// Intel GPUs, so they are compiled out for the SYCL CPU device build.
+#ifndef CCL_SYCL_CPU_DEVICE
 //#include "allreduce.h"
 #include "allreduce_small.h"
+#endif
 
 // pytorch 2.3 above
 #if TORCH_VERSION_MAJOR > 1 && TORCH_VERSION_MINOR > 2
@@ -47,11 +51,13 @@ int disable_allreduce = -1;
 int work_only = -1;
 int sync_only = -1;
 
+#ifndef CCL_SYCL_CPU_DEVICE
 //allreducer<sycl::ext::oneapi::bfloat16, 8, 4096> gpu_allreducer_bf16;
 allreducer<sycl::half, 8, 4096> gpu_allreducer_fp16;
 allreducer_small<sycl::half, 8, 4096> gpu_allreducer_small_fp16;
 allreducer_small<sycl::half, 8, 4096> gpu_allreducer_small_fp32;
 allreducer_small<sycl::half, 8, 4096> gpu_allreducer_small_bf16;
+#endif
 
 
 int get_disable_allreduce(int init_value = 0) {
@@ -111,8 +117,10 @@ namespace
         c10::Stream stream = impl.getStream(devices[0]);
         auto q = get_sycl_queue(stream);
         
+#ifndef CCL_SYCL_CPU_DEVICE
         gpu_allreducer_fp16.init(q, local_base_rank, total_rank_size);
         gpu_allreducer_small_fp16.init(q, local_base_rank, total_rank_size);
+#endif
 
         // Get device properity.
         auto dev = q.get_device();
@@ -153,6 +161,9 @@ namespace
     }
 
     bool llm_allreduce_available(const at::Tensor& input, const int world_size, const int local_world_size, const c10d::AllreduceOptions& opts) {
+#ifdef CCL_SYCL_CPU_DEVICE
+        return false;
+#else
         if (support_fp64 &&
             use_llm_allreduce !=0 &&
             opts.reduceOp == c10d::ReduceOp::SUM &&
@@ -163,6 +174,7 @@ namespace
             return true;
         }
         return false;
+#endif
     }
 } // namespace
 
@@ -350,10 +362,12 @@ Comms& get_ccl_comms(c10d::ProcessGroupCCL& pg_ccl, const std::string& devices_k
   auto dpcpp_comms = ccl::create_communicators(total_rank_size, devs_rank, ctx, pg_ccl.ccl_member_->get_kvs(pg_ccl.getRank(), *pg_ccl.store_));
 
   // Initialize allreducer only if use_llm_allreduce is set to nonzero.
+#ifndef CCL_SYCL_CPU_DEVICE
   if (use_llm_allreduce != 0){
     std::call_once(allreducer_initialize_flag, init_llm_allreducer, pg_ccl, devices);
     std::cout << "Allreduce goes to LLM path." << std::endl;
   }
+#endif
   
   // Store the comms to cache
   std::shared_ptr<Comms> dpcpp_comms_ptr = std::make_shared<Comms>(dpcpp_comms, ccl_streams, torch_streams);
@@ -524,8 +538,7 @@ class XPUCCLStubs final: public DispatchStub {
 
 public:
 
-  XPUCCLStubs() {
-    stop_=false;
+  XPUCCLStubs() : queue_(kWorkQueueCapacity) {
     workerThread_ = std::thread(&XPUCCLStubs::runLoop, this);
   }
 
@@ -619,17 +632,16 @@ protected:
 
   virtual c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> end_coalescing_(ProcessGroupCCL& pg_ccl) override;
 
+  std::shared_ptr<Comms> get_comms_(const at::Device& device, ProcessGroupCCL& pg_ccl) override;
+
   void destroy();
   void reset() override {}
   void runLoop();
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> execute(c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> & work);
 private:
-  bool stop_;
-  std::mutex pgMutex_;
   std::thread workerThread_;
-  std::deque<c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>> queue_;
-  std::condition_variable queueProduceCV_;
-  std::condition_variable queueConsumeCV_;
+  // Works tracked until completion by workerThread_.
+  oneccl_bindings_for_pytorch::MPSCQueue<c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL>> queue_;
 
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> allreduce_impl(std::vector<at::Tensor>& tensors,
                                                             const AllreduceOptions& opts,
@@ -668,44 +680,22 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::execute(c10::intr
   work->finishAsyncWorkCCL();
 
   // Track the work internal
-  std::unique_lock<std::mutex> lock(pgMutex_);
-  queue_.push_back(work);
-  lock.unlock();
-  queueProduceCV_.notify_one();
+  queue_.push(work);
 
   return work;
 }
 
 void XPUCCLStubs::destroy() {
-  std::unique_lock<std::mutex> lock(pgMutex_);
-  queueConsumeCV_.wait(lock, [&] { return queue_.empty(); });
-
-  // Queue is empty, signal stop
-  stop_ = true;
-
-  // Release lock to allow threads to terminate
-  lock.unlock();
-  queueProduceCV_.notify_all();
+  // The worker drains the queue before it exits.
+  queue_.close();
 
   // Join the single worker thread
   workerThread_.join();
 }
 
 void XPUCCLStubs::runLoop() {
-  std::unique_lock<std::mutex> lock(pgMutex_);
-  while (!stop_) {
-    if (queue_.empty()) {
-      queueProduceCV_.wait(lock);
-      continue;
-    }
-
-    auto work = std::move(queue_.front());
-
-    queue_.pop_front();
-
-    lock.unlock();
-    queueConsumeCV_.notify_one();
-
+  c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
+  while (queue_.pop(work)) {
     try {
       work->synchronize();
 //      work->finishAsyncWorkCCL();
@@ -714,7 +704,7 @@ void XPUCCLStubs::runLoop() {
 //      work->finishAsyncWorkCCLError(std::current_exception());
     }
 
-    lock.lock();
+    work.reset();
   }
 }
 
@@ -728,9 +718,19 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::allreduce_impl(st
   const auto devices = get_device_list(tensors);
   check_llm_allreduce_env(pg_ccl, devices);
 
+  // PREMUL_SUM sums a scaled staging copy into the tensor, out of place.
+  // The staging copy goes through oneCCL, never the in place LLM allreduce.
+  std::vector<at::Tensor> inputs = tensors;
+  const bool premul = isPremulSum(opts.reduceOp);
+  if (premul) {
+    TORCH_CHECK(tensors.size() == 1, "PREMUL_SUM allreduce takes a single tensor");
+    inputs[0] = tensors[0].mul(premulFactor(opts.reduceOp, tensors[0]));
+  }
+  const ccl::reduction op = premul ? ccl::reduction::sum : cclOp(opts.reduceOp);
+
   work = collective<get_ccl_comms, XPUWorkCCL>(
     pg_ccl,
-    tensors,
+    inputs,
     tensors,
     [=](at::Tensor input,
         at::Tensor output,
@@ -739,13 +739,14 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::allreduce_impl(st
         ccl::stream& stream) {
 
       ccl::event ret_evt;
-      if (disable_allreduce != 0 || world_size == 1) {
+      if (!premul && (disable_allreduce != 0 || world_size == 1)) {
         sycl::event sycl_evt;
 	sycl_evt = stream.get_native().ext_oneapi_submit_barrier();
         return ccl::event::create_from_native(sycl_evt);
       }
 
-      if (llm_allreduce_available(input, world_size, local_world_size, opts)) {
+#ifndef CCL_SYCL_CPU_DEVICE
+      if (!premul && llm_allreduce_available(input, world_size, local_world_size, opts)) {
         auto q = get_sycl_queue(llm_torch_stream);
         /*
         if (sync_only != 0) {
@@ -766,13 +767,14 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::allreduce_impl(st
         // printf("Use LLM allreduce.\n");
         return ret_evt;
     }
+#endif
 
     call_with_lock(c10d::ProcessGroupCCL::globalMutex, [&](){
         CCL_CHECK(ret_evt = ccl::allreduce(input.data_ptr(),
                                             output.data_ptr(),
                                             (size_t) input.numel(),
                                             cclDatatypes.at(input.scalar_type()),
-                                            cclOps.at(opts.reduceOp),
+                                            op,
                                             comm,
                                             stream,
                                             attr));
@@ -830,7 +832,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::reduce_(std::vect
                                 output.data_ptr(),
                                 (size_t) input.numel(),
                                 cclDatatypes.at(input.scalar_type()),
-                                cclOps.at(opts.reduceOp),
+                                cclOp(opts.reduceOp),
                                 root,
                                 comm,
                                 stream));
@@ -872,7 +874,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::_reduce_oop(at::T
                                 output.data_ptr(),
                                 (size_t) input.numel(),
                                 cclDatatypes.at(input.scalar_type()),
-                                cclOps.at(opts.reduceOp),
+                                cclOp(opts.reduceOp),
                                 root,
                                 comm,
                                 stream));
@@ -921,7 +923,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::reduce_scatter_(s
                                                         output.data_ptr(),
                                                         (size_t) output.numel(),
                                                         cclDatatypes.at(input.scalar_type()),
-                                                        cclOps.at(opts.reduceOp),
+                                                        cclOp(opts.reduceOp),
                                                         comm,
                                                         stream));
                 });
@@ -988,7 +990,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::_reduce_scatter_b
                                                       output.data_ptr(),
                                                       (size_t) output.numel(),
                                                       cclDatatypes.at(input.scalar_type()),
-                                                      cclOps.at(opts.reduceOp),
+                                                      cclOp(opts.reduceOp),
                                                       comm,
                                                       stream));
             });
@@ -1025,7 +1027,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::reduce_scatter_te
                                                       output.data_ptr(),
                                                       (size_t) output.numel(),
                                                       cclDatatypes.at(input.scalar_type()),
-                                                      cclOps.at(opts.reduceOp),
+                                                      cclOp(opts.reduceOp),
                                                       comm,
                                                       stream));
             });
@@ -1673,6 +1675,16 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> XPUCCLStubs::end_coalescing_(P
   return work;    
 }
 
+std::shared_ptr<Comms> XPUCCLStubs::get_comms_(const at::Device& device, ProcessGroupCCL& pg_ccl) {
+  auto key = get_key_from_devs({device});
+  auto& comms = get_ccl_comms(pg_ccl, key, {device});
+  if (pg_ccl.useSameStream_) {
+    // Communicators are cached per stream in this mode, see get_ccl_comms.
+    key += "_" + std::to_string(comms.torch_streams[0].id());
+  }
+  return pg_ccl.ccl_member_->get_comms(key);
+}
+
 RegisterXPUMethods xpu_register;
 
 }
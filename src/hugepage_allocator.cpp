@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <c10/util/accumulate.h>
+
+#include "hugepage_allocator.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+// MPOL_BIND from <linux/mempolicy.h>, kept local to avoid a libnuma dependency.
+constexpr int kMpolBind = 2;
+
+size_t roundUpToHugePage(size_t bytes) {
+  return (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+}
+
+void bindToNumaNode(void* ptr, size_t len, int numa_node) {
+  constexpr size_t kBitsPerWord = sizeof(unsigned long) * 8;
+  std::vector<unsigned long> nodemask(numa_node / kBitsPerWord + 1, 0);
+  nodemask[numa_node / kBitsPerWord] |= 1UL << (numa_node % kBitsPerWord);
+  if (syscall(SYS_mbind, ptr, len, kMpolBind, nodemask.data(), nodemask.size() * kBitsPerWord + 1, 0) != 0) {
+    TORCH_WARN_ONCE("oneccl_bindings_for_pytorch: mbind to NUMA node ", numa_node,
+                    " failed: ", strerror(errno), ", huge page buffers are not bound");
+  }
+}
+
+struct HugePageConfig {
+  bool enabled = false;
+  int numa_node = -1;
+  size_t cache_bytes = 512 * 1024 * 1024;
+
+  HugePageConfig() {
+    if (const char* val = getenv(TORCH_CCL_HUGEPAGE)) {
+      enabled = atoi(val) != 0;
+    }
+    if (const char* val = getenv(TORCH_CCL_HUGEPAGE_NUMA_NODE)) {
+      numa_node = atoi(val);
+    }
+    if (const char* val = getenv(TORCH_CCL_HUGEPAGE_CACHE_MB)) {
+      cache_bytes = static_cast<size_t>(std::max(atoll(val), 0LL)) * 1024 * 1024;
+    }
+  }
+};
+
+const HugePageConfig& hugePageConfig() {
+  static HugePageConfig config;
+  return config;
+}
+
+// Released comm buffers, still mapped, by their rounded up length. A
+// collective staging the same sizes as the previous one takes its regions
+// back without mmap, page faults or munmap. When a release would exceed the
+// capacity, regions of other lengths are unmapped first.
+class HugePagePool {
+public:
+  explicit HugePagePool(size_t capacity) : capacity_(capacity) {}
+
+  void* take(size_t len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = free_.find(len);
+    if (it == free_.end() || it->second.empty()) {
+      return nullptr;
+    }
+    void* ptr = it->second.back();
+    it->second.pop_back();
+    cached_ -= len;
+    return ptr;
+  }
+
+  void give(void* ptr, size_t len) {
+    std::vector<std::pair<void*, size_t>> evicted;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = free_.begin(); it != free_.end() && cached_ + len > capacity_; ++it) {
+        while (it->first != len && !it->second.empty() && cached_ + len > capacity_) {
+          evicted.emplace_back(it->second.back(), it->first);
+          it->second.pop_back();
+          cached_ -= it->first;
+        }
+      }
+      if (cached_ + len <= capacity_) {
+        free_[len].push_back(ptr);
+        cached_ += len;
+        ptr = nullptr;
+      }
+    }
+    for (auto& region : evicted) {
+      munmap(region.first, region.second);
+    }
+    if (ptr != nullptr) {
+      munmap(ptr, len);
+    }
+  }
+
+private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::unordered_map<size_t, std::vector<void*>> free_;
+  size_t cached_ = 0;
+};
+
+HugePagePool& hugePagePool() {
+  // Never destroyed, buffers may be released during static destruction.
+  static HugePagePool* pool = new HugePagePool(hugePageConfig().cache_bytes);
+  return *pool;
+}
+
+} // namespace
+
+void* allocHugePages(size_t bytes, int numa_node) {
+  const size_t len = roundUpToHugePage(bytes);
+  void* ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr == MAP_FAILED) {
+    // No hugetlb pages reserved, fall back to transparent huge pages. Over map
+    // by one huge page and trim so that the range is 2MB aligned.
+    const size_t map_len = len + kHugePageSize;
+    char* base = static_cast<char*>(mmap(nullptr, map_len, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    TORCH_CHECK(base != MAP_FAILED, "oneccl_bindings_for_pytorch: mmap of ", map_len,
+                " bytes failed: ", strerror(errno));
+    char* aligned = reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(base) + kHugePageSize - 1) / kHugePageSize * kHugePageSize);
+    if (aligned != base) {
+      munmap(base, aligned - base);
+    }
+    const size_t tail = (base + map_len) - (aligned + len);
+    if (tail > 0) {
+      munmap(aligned + len, tail);
+    }
+    ptr = aligned;
+    if (madvise(ptr, len, MADV_HUGEPAGE) != 0) {
+      TORCH_WARN_ONCE("oneccl_bindings_for_pytorch: madvise(MADV_HUGEPAGE) failed: ", strerror(errno),
+                      ", communication buffers use 4K pages");
+    }
+  }
+  if (numa_node >= 0) {
+    bindToNumaNode(ptr, len, numa_node);
+  }
+  return ptr;
+}
+
+void freeHugePages(void* ptr, size_t bytes) {
+  if (ptr != nullptr) {
+    munmap(ptr, roundUpToHugePage(bytes));
+  }
+}
+
+at::Tensor emptyHugePageBytes(int64_t nbytes, int numa_node) {
+  TORCH_CHECK(nbytes >= 0, "emptyHugePageBytes: negative size ", nbytes);
+  if (nbytes == 0) {
+    return at::empty({0}, at::kByte);
+  }
+  const size_t bytes = static_cast<size_t>(nbytes);
+  void* ptr = allocHugePages(bytes, numa_node);
+  return at::from_blob(ptr, {nbytes}, [bytes](void* p) { freeHugePages(p, bytes); },
+                       at::TensorOptions().dtype(at::kByte).device(at::kCPU));
+}
+
+at::Tensor emptyCommBuffer(at::IntArrayRef sizes, const at::TensorOptions& options) {
+  const auto& config = hugePageConfig();
+  if (!config.enabled || !options.device().is_cpu()) {
+    return at::empty(sizes, options);
+  }
+  const int64_t nbytes = c10::multiply_integers(sizes) * static_cast<int64_t>(options.dtype().itemsize());
+  if (nbytes < static_cast<int64_t>(kHugePageSize)) {
+    return at::empty(sizes, options);
+  }
+  const size_t len = roundUpToHugePage(static_cast<size_t>(nbytes));
+  auto& pool = hugePagePool();
+  void* ptr = pool.take(len);
+  if (ptr == nullptr) {
+    ptr = allocHugePages(len, config.numa_node);
+  }
+  return at::from_blob(ptr, sizes, [len](void* p) { hugePagePool().give(p, len); }, options);
+}
+
+} // namespace oneccl_bindings_for_pytorch
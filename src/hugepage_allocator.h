@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <ATen/ATen.h>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Environment variable which makes the internal communication staging buffers
+// use huge pages.
+constexpr const char* TORCH_CCL_HUGEPAGE = "TORCH_CCL_HUGEPAGE";
+
+// Environment variable which binds the huge page buffers to one NUMA node.
+constexpr const char* TORCH_CCL_HUGEPAGE_NUMA_NODE = "TORCH_CCL_HUGEPAGE_NUMA_NODE";
+
+// Environment variable capping the MB of released staging buffers kept mapped
+// for reuse by later collectives.
+constexpr const char* TORCH_CCL_HUGEPAGE_CACHE_MB = "TORCH_CCL_HUGEPAGE_CACHE_MB";
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Map `bytes` rounded up to whole huge pages. Explicit hugetlb pages are tried
+// first, then a 2MB aligned anonymous mapping advised with MADV_HUGEPAGE.
+// A non-negative `numa_node` binds the pages to that node before first touch.
+void* allocHugePages(size_t bytes, int numa_node = -1);
+
+void freeHugePages(void* ptr, size_t bytes);
+
+// Uninitialized uint8 CPU tensor of `nbytes` backed by huge pages.
+at::Tensor emptyHugePageBytes(int64_t nbytes, int numa_node = -1);
+
+// Staging buffer used by the collectives. It is backed by huge pages when
+// TORCH_CCL_HUGEPAGE is set and spans at least one huge page, and comes from
+// at::empty otherwise. Released huge page buffers go back to a pool of mapped
+// regions by length, up to TORCH_CCL_HUGEPAGE_CACHE_MB, which the next
+// buffers of the same length reuse.
+at::Tensor emptyCommBuffer(at::IntArrayRef sizes, const at::TensorOptions& options);
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <c10/util/Exception.h>
+
+#include "in_flight_limiter.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+void InFlightLimiter::Slot::release() {
+  if (!released_.exchange(true)) {
+    limiter_->release();
+  }
+}
+
+thread_local bool InFlightLimiter::exempt_ = false;
+
+InFlightLimiter::InFlightLimiter(int64_t limit) : limit_(limit) {
+  TORCH_CHECK(limit > 0, "InFlightLimiter needs a positive limit");
+}
+
+std::shared_ptr<InFlightLimiter::Slot> InFlightLimiter::acquire() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return exempt_ || count_ < limit_; });
+    count_++;
+  }
+  return std::make_shared<Slot>(shared_from_this());
+}
+
+void InFlightLimiter::exemptCurrentThread() {
+  exempt_ = true;
+}
+
+void InFlightLimiter::release() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_--;
+  }
+  cv_.notify_one();
+}
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Bounds the number of CPU works of a process group which were issued and
+// have not completed yet. acquire() blocks the issuing thread while the limit
+// is reached. The slot it returns gives its place back when it is released
+// or destroyed, whichever comes first.
+//
+// The progress thread and the callback threads free the slots, so they never
+// wait: a future callback chaining a collective there, e.g. a DDP comm hook,
+// would wait on itself. Their collectives may go past the limit.
+class InFlightLimiter : public std::enable_shared_from_this<InFlightLimiter> {
+public:
+  class Slot {
+  public:
+    explicit Slot(std::shared_ptr<InFlightLimiter> limiter) : limiter_(std::move(limiter)) {}
+    ~Slot() { release(); }
+
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+
+    void release();
+
+  private:
+    std::shared_ptr<InFlightLimiter> limiter_;
+    std::atomic<bool> released_{false};
+  };
+
+  explicit InFlightLimiter(int64_t limit);
+
+  std::shared_ptr<Slot> acquire();
+
+  // Lets acquire() on the calling thread take a slot without waiting.
+  static void exemptCurrentThread();
+
+private:
+  void release();
+
+  static thread_local bool exempt_;
+
+  const int64_t limit_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int64_t count_ = 0;
+};
+
+} // namespace oneccl_bindings_for_pytorch
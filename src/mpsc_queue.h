@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Lock-free ring for many producers and one consumer. Producers claim a
+// slot with a CAS on the tail and publish it through the slot's sequence
+// number, so an enqueue takes no lock and only makes a syscall when the
+// consumer is parked. The idle consumer parks on a futex.
+//
+// A push never waits: the consumer may itself be a producer, e.g. a future
+// callback run on the progress thread chaining a collective. Once the ring
+// is full the values go to a locked overflow list, and keep going there
+// until the consumer drained it, which keeps them in push order.
+template <typename T>
+class MPSCQueue {
+public:
+  explicit MPSCQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    slots_.reset(new Slot[size]);
+    for (size_t i = 0; i < size; i++) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  void push(T value) {
+    if (!pushToRing(value)) {
+      std::lock_guard<std::mutex> lock(overflowMutex_);
+      overflow_.push_back(std::move(value));
+      overflowing_.store(true, std::memory_order_release);
+    }
+
+    // Pairs with the fence in pop(): either the consumer sees the value or
+    // we see it waiting. Only the first producer to see it makes the syscall.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerWaiting_.load(std::memory_order_relaxed) &&
+        consumerWaiting_.exchange(0, std::memory_order_relaxed)) {
+      consumerEpoch_.fetch_add(1, std::memory_order_release);
+      futexWake(consumerEpoch_, 1);
+    }
+  }
+
+  // Consumer only. The ring holds the older values, so it is drained
+  // before the overflow list, and the producers go back to the ring once
+  // both are empty.
+  bool tryPop(T& value) {
+    Slot& slot = slots_[head_ & mask_];
+    if (slot.seq.load(std::memory_order_acquire) == head_ + 1) {
+      value = std::move(slot.value);
+      slot.value = T();
+      slot.seq.store(head_ + mask_ + 1, std::memory_order_release);
+      head_++;
+      return true;
+    }
+    if (!overflowing_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(overflowMutex_);
+    if (overflow_.empty()) {
+      // A producer may have claimed a slot before overflowing_ was set and
+      // not published it yet, keep the others off the ring until it has.
+      if (tail_.load(std::memory_order_acquire) == head_) {
+        overflowing_.store(false, std::memory_order_release);
+      }
+      return false;
+    }
+    value = std::move(overflow_.front());
+    overflow_.pop_front();
+    return true;
+  }
+
+  // Consumer only. Parks while the ring is empty, returns false once the
+  // queue is closed and drained.
+  bool pop(T& value) {
+    for (;;) {
+      for (int i = 0; i < kSpinCount; i++) {
+        if (tryPop(value)) {
+          return true;
+        }
+        cpuRelax();
+      }
+      uint32_t epoch = consumerEpoch_.load(std::memory_order_acquire);
+      consumerWaiting_.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!empty()) {
+        consumerWaiting_.store(0, std::memory_order_relaxed);
+        continue;
+      }
+      if (closed_.load(std::memory_order_acquire)) {
+        consumerWaiting_.store(0, std::memory_order_relaxed);
+        return false;
+      }
+      futexWait(consumerEpoch_, epoch);
+      consumerWaiting_.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Consumer only.
+  bool empty() {
+    if (slots_[head_ & mask_].seq.load(std::memory_order_acquire) == head_ + 1) {
+      return false;
+    }
+    if (!overflowing_.load(std::memory_order_acquire)) {
+      return true;
+    }
+    std::lock_guard<std::mutex> lock(overflowMutex_);
+    return overflow_.empty();
+  }
+
+  // Let pop() return false once the pushed values are drained. No value may
+  // be pushed after this.
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    consumerEpoch_.fetch_add(1, std::memory_order_release);
+    futexWake(consumerEpoch_, INT_MAX);
+  }
+
+private:
+  static constexpr int kSpinCount = 64;
+
+  struct alignas(64) Slot {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  static void futexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+  }
+
+  static void futexWake(std::atomic<uint32_t>& word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+  }
+
+  // False, leaving `value` alone, when the ring is full or values are
+  // still waiting in the overflow list.
+  bool pushToRing(T& value) {
+    if (overflowing_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(value);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) size_t head_ = 0;
+  alignas(64) std::atomic<uint32_t> consumerEpoch_{0};
+  std::atomic<uint32_t> consumerWaiting_{0};
+  alignas(64) std::atomic<bool> overflowing_{false};
+  std::mutex overflowMutex_;
+  std::deque<T> overflow_;
+  std::atomic<bool> closed_{false};
+};
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "process_group_factory.h"
+
+#include "ProcessGroupCCL.hpp"
+
+namespace oneccl_bindings_for_pytorch {
+
+c10::intrusive_ptr<c10d::ProcessGroup> createProcessGroup(
+    const c10::intrusive_ptr<c10d::Store>& store,
+    int rank,
+    int size,
+    std::chrono::milliseconds timeout) {
+  TORCH_CHECK(size > 0 && rank >= 0 && rank < size,
+              "createProcessGroup: rank ", rank, " is out of range for ", size, " ranks");
+  c10d::ProcessGroupCCL::cclInitOnce();
+  auto options = c10d::ProcessGroupCCL::Options::create(timeout);
+  auto backend = c10d::ProcessGroupCCL::createProcessGroupCCL(store, rank, size, timeout, options);
+#if TORCH_VERSION_MAJOR > 1
+  // The same wiring as torch.distributed does for a backend registered for
+  // the cpu and xpu devices.
+#if TORCH_VERSION_MINOR >= 4
+  auto pg = c10::make_intrusive<c10d::ProcessGroup>(store, rank, size);
+#else
+  auto pg_options = c10::make_intrusive<c10d::ProcessGroup::Options>(c10d::CCL_BACKEND_NAME, timeout);
+  auto pg = c10::make_intrusive<c10d::ProcessGroup>(store, rank, size, pg_options);
+#endif
+  pg->setBackend(c10::DeviceType::CPU, c10d::ProcessGroup::BackendType::CUSTOM, backend);
+  pg->setBackend(c10::DeviceType::XPU, c10d::ProcessGroup::BackendType::CUSTOM, backend);
+  pg->setDefaultBackend(c10d::ProcessGroup::BackendType::CUSTOM);
+  return pg;
+#else
+  return backend;
+#endif
+}
+
+} // namespace oneccl_bindings_for_pytorch
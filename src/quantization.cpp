@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <vector>
+
+#include <ATen/Dispatch.h>
+#include <ATen/Parallel.h>
+#include <torch/version.h>
+#if TORCH_VERSION_MAJOR > 1 && TORCH_VERSION_MINOR >= 1
+#include <c10/util/Float8_e4m3fn.h>
+#define CCL_QUANT_HAS_FP8 1
+#endif
+
+#include "quantization.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+constexpr float kInt8Max = 127.0f;
+constexpr float kFp8E4M3Max = 448.0f;
+// Blocks handled by one intra-op task.
+constexpr int64_t kQuantGrainBlocks = 16;
+
+int64_t numBlocks(int64_t numel, int64_t block_size) {
+  return (numel + block_size - 1) / block_size;
+}
+
+float quantMax(CommQuantType type) {
+  return type == CommQuantType::INT8 ? kInt8Max : kFp8E4M3Max;
+}
+
+template <typename scalar_t>
+void quantize_kernel(const scalar_t* in,
+                     float* scales,
+                     uint8_t* q,
+                     int64_t numel,
+                     int64_t block_size,
+                     CommQuantType type) {
+  const float qmax = quantMax(type);
+  at::parallel_for(0, numBlocks(numel, block_size), kQuantGrainBlocks, [&](int64_t begin, int64_t end) {
+    std::vector<float> buf(block_size);
+    for (int64_t b = begin; b < end; b++) {
+      const int64_t start = b * block_size;
+      const int64_t len = std::min(block_size, numel - start);
+      const scalar_t* src = in + start;
+      float* vals = buf.data();
+
+      float absmax = 0.0f;
+      for (int64_t i = 0; i < len; i++) {
+        vals[i] = static_cast<float>(src[i]);
+        absmax = std::max(absmax, std::abs(vals[i]));
+      }
+      const float scale = absmax > 0.0f ? absmax / qmax : 1.0f;
+      const float inv_scale = 1.0f / scale;
+      scales[b] = scale;
+
+      if (type == CommQuantType::INT8) {
+        int8_t* dst = reinterpret_cast<int8_t*>(q + start);
+        for (int64_t i = 0; i < len; i++) {
+          float v = std::nearbyint(vals[i] * inv_scale);
+          dst[i] = static_cast<int8_t>(std::min(std::max(v, -kInt8Max), kInt8Max));
+        }
+      } else {
+#ifdef CCL_QUANT_HAS_FP8
+        uint8_t* dst = q + start;
+        for (int64_t i = 0; i < len; i++) {
+          dst[i] = c10::Float8_e4m3fn(vals[i] * inv_scale).x;
+        }
+#endif
+      }
+    }
+  });
+}
+
+template <typename scalar_t>
+void dequantize_kernel(const float* scales,
+                       const uint8_t* q,
+                       scalar_t* out,
+                       int64_t numel,
+                       int64_t block_size,
+                       CommQuantType type) {
+  at::parallel_for(0, numBlocks(numel, block_size), kQuantGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; b++) {
+      const int64_t start = b * block_size;
+      const int64_t len = std::min(block_size, numel - start);
+      const float scale = scales[b];
+      scalar_t* dst = out + start;
+
+      if (type == CommQuantType::INT8) {
+        const int8_t* src = reinterpret_cast<const int8_t*>(q + start);
+        for (int64_t i = 0; i < len; i++) {
+          dst[i] = static_cast<scalar_t>(static_cast<float>(src[i]) * scale);
+        }
+      } else {
+#ifdef CCL_QUANT_HAS_FP8
+        const uint8_t* src = q + start;
+        for (int64_t i = 0; i < len; i++) {
+          float v = c10::Float8_e4m3fn(src[i], c10::Float8_e4m3fn::from_bits());
+          dst[i] = static_cast<scalar_t>(v * scale);
+        }
+#endif
+      }
+    }
+  });
+}
+
+void checkQuantArgs(const at::Tensor& data, const at::Tensor& packed, CommQuantType type, int64_t block_size) {
+  TORCH_CHECK(type != CommQuantType::NONE, "quantization type must not be none");
+#ifndef CCL_QUANT_HAS_FP8
+  TORCH_CHECK(type != CommQuantType::FP8_E4M3, "fp8 quantization requires PyTorch 2.1 or later");
+#endif
+  TORCH_CHECK(block_size > 0, "quantization block size must be positive");
+  TORCH_CHECK(at::isFloatingType(data.scalar_type()), "quantization only supports floating point tensors");
+  TORCH_CHECK(data.is_contiguous() && packed.is_contiguous(), "quantization requires contiguous tensors");
+  TORCH_CHECK(packed.scalar_type() == at::kByte, "quantized buffer must be uint8");
+  TORCH_CHECK(packed.numel() >= quantizedShardBytes(data.numel(), block_size),
+              "quantized buffer is too small for ", data.numel(), " elements");
+}
+
+} // namespace
+
+CommQuantType parseCommQuantType(const std::string& name) {
+  std::string lower(name);
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  if (lower.empty() || lower == "none" || lower == "0") {
+    return CommQuantType::NONE;
+  }
+  if (lower == "int8") {
+    return CommQuantType::INT8;
+  }
+  if (lower == "fp8" || lower == "fp8_e4m3") {
+    return CommQuantType::FP8_E4M3;
+  }
+  TORCH_CHECK(false, "Unknown communication quantization type: ", name, ". Expected one of none, int8, fp8");
+}
+
+std::string commQuantTypeName(CommQuantType type) {
+  switch (type) {
+    case CommQuantType::INT8:
+      return "int8";
+    case CommQuantType::FP8_E4M3:
+      return "fp8";
+    default:
+      return "none";
+  }
+}
+
+int64_t quantizedShardBytes(int64_t numel, int64_t block_size) {
+  int64_t bytes = numBlocks(numel, block_size) * static_cast<int64_t>(sizeof(float)) + numel;
+  return (bytes + sizeof(float) - 1) / sizeof(float) * sizeof(float);
+}
+
+void quantizeBlockwise(const at::Tensor& input,
+                       at::Tensor& packed,
+                       CommQuantType type,
+                       int64_t block_size) {
+  checkQuantArgs(input, packed, type, block_size);
+  const int64_t numel = input.numel();
+  uint8_t* base = packed.data_ptr<uint8_t>();
+  float* scales = reinterpret_cast<float*>(base);
+  uint8_t* q = base + numBlocks(numel, block_size) * sizeof(float);
+
+  AT_DISPATCH_FLOATING_TYPES_AND2(at::kBFloat16, at::kHalf, input.scalar_type(), "quantizeBlockwise", [&] {
+    quantize_kernel<scalar_t>(input.data_ptr<scalar_t>(), scales, q, numel, block_size, type);
+  });
+}
+
+void dequantizeBlockwise(const at::Tensor& packed,
+                         at::Tensor& output,
+                         CommQuantType type,
+                         int64_t block_size) {
+  checkQuantArgs(output, packed, type, block_size);
+  const int64_t numel = output.numel();
+  const uint8_t* base = packed.data_ptr<uint8_t>();
+  const float* scales = reinterpret_cast<const float*>(base);
+  const uint8_t* q = base + numBlocks(numel, block_size) * sizeof(float);
+
+  AT_DISPATCH_FLOATING_TYPES_AND2(at::kBFloat16, at::kHalf, output.scalar_type(), "dequantizeBlockwise", [&] {
+    dequantize_kernel<scalar_t>(scales, q, output.data_ptr<scalar_t>(), numel, block_size, type);
+  });
+}
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <ATen/ATen.h>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Wire format used to compress the shards of an allgather.
+enum class CommQuantType : uint8_t {
+  NONE = 0,
+  INT8,
+  FP8_E4M3,
+};
+
+constexpr int64_t kDefaultQuantBlockSize = 256;
+// Shards smaller than this are gathered exactly even when quantization is on,
+// so metadata and small state dict gathers are not rounded.
+constexpr int64_t kDefaultQuantMinBytes = 1 << 20;
+
+CommQuantType parseCommQuantType(const std::string& name);
+
+std::string commQuantTypeName(CommQuantType type);
+
+// Size in bytes of one quantized shard: the fp32 per-block scales followed by
+// one byte per element, rounded up to keep the next shard's scales aligned.
+int64_t quantizedShardBytes(int64_t numel, int64_t block_size);
+
+// Quantize the contiguous floating point `input` into the uint8 `packed` buffer.
+// Each block is read from `input` once: the absmax loop widens it into an fp32
+// scratch of block_size elements, which the rounding loop reads from cache.
+void quantizeBlockwise(const at::Tensor& input,
+                       at::Tensor& packed,
+                       CommQuantType type,
+                       int64_t block_size);
+
+// Dequantize one shard of `packed` straight into the contiguous `output`.
+void dequantizeBlockwise(const at::Tensor& packed,
+                         at::Tensor& output,
+                         CommQuantType type,
+                         int64_t block_size);
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <ATen/Parallel.h>
+#include <c10/util/Exception.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CCL_SPARSE_HAS_AVX512 1
+#endif
+
+#include "sparse_codec.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+constexpr uint32_t kSparseMagic = 0x315a5053; // "SPZ1"
+constexpr int64_t kHeaderBytes = 16;
+// Blocks handled by one intra-op task.
+constexpr int64_t kSparseGrainBlocks = 8;
+
+int64_t numBlocks(int64_t numel) {
+  return (numel + kSparseBlockElems - 1) / kSparseBlockElems;
+}
+
+int64_t bitmapBytes(int64_t len) {
+  return (len + 7) / 8;
+}
+
+// Kernels of one block of `len` elements, `values` holds the packed nonzeros.
+struct BlockKernels {
+  int64_t (*count)(const uint8_t* src, int64_t len);
+  void (*encode)(const uint8_t* src, int64_t len, uint8_t* bitmap, uint8_t* values);
+  void (*decode)(const uint8_t* bitmap, const uint8_t* values, int64_t len, uint8_t* dst);
+};
+
+template <typename E>
+int64_t countScalar(const uint8_t* src, int64_t len) {
+  int64_t nnz = 0;
+  for (int64_t i = 0; i < len; i++) {
+    E e;
+    std::memcpy(&e, src + i * sizeof(E), sizeof(E));
+    nnz += e != 0;
+  }
+  return nnz;
+}
+
+template <typename E>
+void encodeScalar(const uint8_t* src, int64_t len, uint8_t* bitmap, uint8_t* values, int64_t begin = 0) {
+  int64_t k = 0;
+  for (int64_t i = begin; i < len; i++) {
+    E e;
+    std::memcpy(&e, src + i * sizeof(E), sizeof(E));
+    if (e != 0) {
+      bitmap[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+      std::memcpy(values + k * sizeof(E), &e, sizeof(E));
+      k++;
+    }
+  }
+}
+
+template <typename E>
+void decodeScalar(const uint8_t* bitmap, const uint8_t* values, int64_t len, uint8_t* dst, int64_t begin = 0) {
+  int64_t k = 0;
+  for (int64_t i = begin; i < len; i++) {
+    E e = 0;
+    if (bitmap[i >> 3] & (1u << (i & 7))) {
+      std::memcpy(&e, values + k * sizeof(E), sizeof(E));
+      k++;
+    }
+    std::memcpy(dst + i * sizeof(E), &e, sizeof(E));
+  }
+}
+
+template <typename E>
+void encodeBlockScalar(const uint8_t* src, int64_t len, uint8_t* bitmap, uint8_t* values) {
+  encodeScalar<E>(src, len, bitmap, values);
+}
+
+template <typename E>
+void decodeBlockScalar(const uint8_t* bitmap, const uint8_t* values, int64_t len, uint8_t* dst) {
+  decodeScalar<E>(bitmap, values, len, dst);
+}
+
+#ifdef CCL_SPARSE_HAS_AVX512
+
+// 16-bit elements, 32 per vector. Compress and expand of words need VBMI2.
+__attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+int64_t countAvx512_16(const uint8_t* src, int64_t len) {
+  int64_t nnz = 0, i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m512i v = _mm512_loadu_si512(src + i * 2);
+    nnz += __builtin_popcount(_mm512_test_epi16_mask(v, v));
+  }
+  return nnz + countScalar<uint16_t>(src + i * 2, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+void encodeAvx512_16(const uint8_t* src, int64_t len, uint8_t* bitmap, uint8_t* values) {
+  int64_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m512i v = _mm512_loadu_si512(src + i * 2);
+    __mmask32 mask = _mm512_test_epi16_mask(v, v);
+    std::memcpy(bitmap + i / 8, &mask, 4);
+    int cnt = __builtin_popcount(mask);
+    __mmask32 store = cnt == 32 ? ~__mmask32(0) : (__mmask32(1) << cnt) - 1;
+    _mm512_mask_storeu_epi16(values, store, _mm512_maskz_compress_epi16(mask, v));
+    values += cnt * 2;
+  }
+  encodeScalar<uint16_t>(src, len, bitmap, values, i);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+void decodeAvx512_16(const uint8_t* bitmap, const uint8_t* values, int64_t len, uint8_t* dst) {
+  int64_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __mmask32 mask;
+    std::memcpy(&mask, bitmap + i / 8, 4);
+    _mm512_storeu_si512(dst + i * 2, _mm512_maskz_expandloadu_epi16(mask, values));
+    values += __builtin_popcount(mask) * 2;
+  }
+  decodeScalar<uint16_t>(bitmap, values, len, dst, i);
+}
+
+// 32-bit elements, 16 per vector.
+__attribute__((target("avx512f,popcnt")))
+int64_t countAvx512_32(const uint8_t* src, int64_t len) {
+  int64_t nnz = 0, i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i v = _mm512_loadu_si512(src + i * 4);
+    nnz += __builtin_popcount(_mm512_test_epi32_mask(v, v));
+  }
+  return nnz + countScalar<uint32_t>(src + i * 4, len - i);
+}
+
+__attribute__((target("avx512f,popcnt")))
+void encodeAvx512_32(const uint8_t* src, int64_t len, uint8_t* bitmap, uint8_t* values) {
+  int64_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i v = _mm512_loadu_si512(src + i * 4);
+    __mmask16 mask = _mm512_test_epi32_mask(v, v);
+    std::memcpy(bitmap + i / 8, &mask, 2);
+    int cnt = __builtin_popcount(mask);
+    _mm512_mask_storeu_epi32(values, static_cast<__mmask16>((1u << cnt) - 1), _mm512_maskz_compress_epi32(mask, v));
+    values += cnt * 4;
+  }
+  encodeScalar<uint32_t>(src, len, bitmap, values, i);
+}
+
+__attribute__((target("avx512f,popcnt")))
+void decodeAvx512_32(const uint8_t* bitmap, const uint8_t* values, int64_t len, uint8_t* dst) {
+  int64_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __mmask16 mask;
+    std::memcpy(&mask, bitmap + i / 8, 2);
+    _mm512_storeu_si512(dst + i * 4, _mm512_maskz_expandloadu_epi32(mask, values));
+    values += __builtin_popcount(mask) * 4;
+  }
+  decodeScalar<uint32_t>(bitmap, values, len, dst, i);
+}
+
+bool hasAvx512_16() {
+  static const bool supported = __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi2");
+  return supported;
+}
+
+bool hasAvx512_32() {
+  static const bool supported = __builtin_cpu_supports("avx512f");
+  return supported;
+}
+
+#endif
+
+template <typename E>
+BlockKernels scalarKernels() {
+  return {countScalar<E>, encodeBlockScalar<E>, decodeBlockScalar<E>};
+}
+
+// Null for element sizes without a kernel, whose blocks always travel dense.
+const BlockKernels* blockKernels(int64_t elem_size) {
+  static const BlockKernels k8 = scalarKernels<uint8_t>();
+  static const BlockKernels k64 = scalarKernels<uint64_t>();
+#ifdef CCL_SPARSE_HAS_AVX512
+  static const BlockKernels k16 = hasAvx512_16()
+      ? BlockKernels{countAvx512_16, encodeAvx512_16, decodeAvx512_16} : scalarKernels<uint16_t>();
+  static const BlockKernels k32 = hasAvx512_32()
+      ? BlockKernels{countAvx512_32, encodeAvx512_32, decodeAvx512_32} : scalarKernels<uint32_t>();
+#else
+  static const BlockKernels k16 = scalarKernels<uint16_t>();
+  static const BlockKernels k32 = scalarKernels<uint32_t>();
+#endif
+  switch (elem_size) {
+    case 1: return &k8;
+    case 2: return &k16;
+    case 4: return &k32;
+    case 8: return &k64;
+    default: return nullptr;
+  }
+}
+
+int64_t blockLen(int64_t numel, int64_t b) {
+  return std::min(kSparseBlockElems, numel - b * kSparseBlockElems);
+}
+
+int64_t blockPayloadBytes(uint32_t nnz, int64_t len, int64_t elem_size) {
+  return nnz == kSparseDenseBlock ? len * elem_size : bitmapBytes(len) + nnz * elem_size;
+}
+
+} // namespace
+
+int64_t sparseEncodedBound(int64_t numel, int64_t elem_size) {
+  return kHeaderBytes + numBlocks(numel) * 4 + numel * elem_size;
+}
+
+int64_t sparseEncodeRaw(const void* src_ptr, int64_t numel, int64_t elem_size, uint8_t* dst) {
+  const auto* src = static_cast<const uint8_t*>(src_ptr);
+  const int64_t nblocks = numBlocks(numel);
+  const BlockKernels* kernels = blockKernels(elem_size);
+
+  uint32_t header[4] = {kSparseMagic, static_cast<uint32_t>(elem_size),
+                        static_cast<uint32_t>(numel), static_cast<uint32_t>(static_cast<uint64_t>(numel) >> 32)};
+  std::memcpy(dst, header, kHeaderBytes);
+  uint8_t* dir = dst + kHeaderBytes;
+  uint8_t* payload = dir + nblocks * 4;
+
+  // Count the nonzeros of every block, then lay the blocks out and fill
+  // them in parallel.
+  std::vector<uint32_t> nnz(nblocks, kSparseDenseBlock);
+  if (kernels) {
+    at::parallel_for(0, nblocks, kSparseGrainBlocks, [&](int64_t begin, int64_t end) {
+      for (int64_t b = begin; b < end; b++) {
+        const int64_t len = blockLen(numel, b);
+        const int64_t count = kernels->count(src + b * kSparseBlockElems * elem_size, len);
+        if (bitmapBytes(len) + count * elem_size < len * elem_size) {
+          nnz[b] = static_cast<uint32_t>(count);
+        }
+      }
+    });
+  }
+  std::vector<int64_t> offsets(nblocks + 1, 0);
+  for (int64_t b = 0; b < nblocks; b++) {
+    offsets[b + 1] = offsets[b] + blockPayloadBytes(nnz[b], blockLen(numel, b), elem_size);
+  }
+  std::memcpy(dir, nnz.data(), nblocks * 4);
+
+  at::parallel_for(0, nblocks, kSparseGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; b++) {
+      const int64_t len = blockLen(numel, b);
+      const uint8_t* block = src + b * kSparseBlockElems * elem_size;
+      uint8_t* out = payload + offsets[b];
+      if (nnz[b] == kSparseDenseBlock) {
+        std::memcpy(out, block, len * elem_size);
+      } else {
+        std::memset(out, 0, bitmapBytes(len));
+        kernels->encode(block, len, out, out + bitmapBytes(len));
+      }
+    }
+  });
+  return kHeaderBytes + nblocks * 4 + offsets[nblocks];
+}
+
+void sparseDecodeRaw(const uint8_t* src, int64_t bytes, void* dst_ptr, int64_t numel, int64_t elem_size) {
+  auto* dst = static_cast<uint8_t*>(dst_ptr);
+  TORCH_CHECK(bytes >= kHeaderBytes, "sparse decode: truncated header");
+  uint32_t header[4];
+  std::memcpy(header, src, kHeaderBytes);
+  const int64_t encoded_numel = static_cast<int64_t>(header[2] | (static_cast<uint64_t>(header[3]) << 32));
+  TORCH_CHECK(header[0] == kSparseMagic && header[1] == elem_size && encoded_numel == numel,
+              "sparse decode: payload does not match the output tensor");
+
+  const int64_t nblocks = numBlocks(numel);
+  TORCH_CHECK(bytes >= kHeaderBytes + nblocks * 4, "sparse decode: truncated block directory");
+  std::vector<uint32_t> nnz(nblocks);
+  std::memcpy(nnz.data(), src + kHeaderBytes, nblocks * 4);
+  const uint8_t* payload = src + kHeaderBytes + nblocks * 4;
+
+  std::vector<int64_t> offsets(nblocks + 1, 0);
+  for (int64_t b = 0; b < nblocks; b++) {
+    offsets[b + 1] = offsets[b] + blockPayloadBytes(nnz[b], blockLen(numel, b), elem_size);
+  }
+  TORCH_CHECK(kHeaderBytes + nblocks * 4 + offsets[nblocks] <= bytes, "sparse decode: truncated payload");
+  const BlockKernels* kernels = blockKernels(elem_size);
+
+  at::parallel_for(0, nblocks, kSparseGrainBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; b++) {
+      const int64_t len = blockLen(numel, b);
+      const uint8_t* in = payload + offsets[b];
+      uint8_t* block = dst + b * kSparseBlockElems * elem_size;
+      if (nnz[b] == kSparseDenseBlock) {
+        std::memcpy(block, in, len * elem_size);
+      } else {
+        kernels->decode(in, in + bitmapBytes(len), len, block);
+      }
+    }
+  });
+}
+
+int64_t sparseEncode(const at::Tensor& input, at::Tensor& encoded) {
+  TORCH_CHECK(input.is_contiguous() && encoded.is_contiguous() && encoded.scalar_type() == at::kByte,
+              "sparse encode: expects a contiguous input and uint8 output");
+  TORCH_CHECK(encoded.numel() >= sparseEncodedBound(input.numel(), input.element_size()),
+              "sparse encode: output buffer too small");
+  return sparseEncodeRaw(input.data_ptr(), input.numel(), input.element_size(), encoded.data_ptr<uint8_t>());
+}
+
+void sparseDecode(const at::Tensor& encoded, at::Tensor& output) {
+  TORCH_CHECK(output.is_contiguous() && encoded.is_contiguous() && encoded.scalar_type() == at::kByte,
+              "sparse decode: expects a uint8 input and contiguous output");
+  sparseDecodeRaw(encoded.data_ptr<uint8_t>(), encoded.numel(), output.data_ptr(), output.numel(),
+                  output.element_size());
+}
+
+bool sparseCodecUsesSimd() {
+#ifdef CCL_SPARSE_HAS_AVX512
+  return hasAvx512_16() || hasAvx512_32();
+#else
+  return false;
+#endif
+}
+
+bool SparseCommPolicy::tryNext() {
+  int skip = skip_.load(std::memory_order_relaxed);
+  if (skip > 0) {
+    skip_.store(skip - 1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void SparseCommPolicy::update(int64_t encoded_bytes, int64_t dense_bytes) {
+  // The size exchange costs a round trip, so ask for at least 10% savings.
+  if (encoded_bytes * 10 > dense_bytes * 9) {
+    skip_.store(kBackoffOps, std::memory_order_relaxed);
+  }
+}
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <ATen/ATen.h>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Lossless zero suppression of communication payloads. A shard is split in
+// blocks of kSparseBlockElems elements and each block travels either dense
+// or as a bitmap of its nonzero elements followed by the packed nonzeros,
+// whichever is smaller. Elements are compared bitwise, so -0.0 and NaN
+// payloads come back unchanged.
+//
+// Layout: [magic u32 | element size u32 | numel u64 | per block u32 nonzero
+// count, kSparseDenseBlock for dense blocks | block payloads].
+constexpr int64_t kSparseBlockElems = 2048;
+constexpr uint32_t kSparseDenseBlock = 0xffffffffu;
+
+// Upper bound of the encoded size of `numel` elements of `elem_size` bytes.
+int64_t sparseEncodedBound(int64_t numel, int64_t elem_size);
+
+// Encode `numel` elements at `src` into `dst`, which holds at least
+// sparseEncodedBound bytes. Returns the encoded size.
+int64_t sparseEncodeRaw(const void* src, int64_t numel, int64_t elem_size, uint8_t* dst);
+
+// Decode `bytes` bytes of `src` into `numel` elements at `dst`.
+void sparseDecodeRaw(const uint8_t* src, int64_t bytes, void* dst, int64_t numel, int64_t elem_size);
+
+// Tensor wrappers over a contiguous `input`/`output` and a uint8 `encoded` buffer.
+int64_t sparseEncode(const at::Tensor& input, at::Tensor& encoded);
+void sparseDecode(const at::Tensor& encoded, at::Tensor& output);
+
+// Whether the AVX-512 kernels are used on this CPU.
+bool sparseCodecUsesSimd();
+
+// Decides whether the next op of a group goes through the sparse encoding.
+// It is only consulted and updated from the ops' run(), with sizes known to
+// every rank, so all ranks take the same decision for the same op.
+class SparseCommPolicy {
+public:
+  bool tryNext();
+
+  // Back off to dense for a while when the encoding saved too little.
+  void update(int64_t encoded_bytes, int64_t dense_bytes);
+
+private:
+  static constexpr int kBackoffOps = 16;
+  std::atomic<int> skip_{0};
+};
+
+} // namespace oneccl_bindings_for_pytorch
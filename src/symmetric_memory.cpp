@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "symmetric_memory.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+int64_t* flagAt(const at::Tensor& flags, int64_t index) {
+  TORCH_CHECK(flags.device().is_cpu() && flags.scalar_type() == at::kLong && flags.is_contiguous(),
+              "symmetric flags have to be a contiguous int64 CPU tensor");
+  TORCH_CHECK(index >= 0 && index < flags.numel(), "symmetric flag index ", index, " out of range");
+  return flags.data_ptr<int64_t>() + index;
+}
+
+} // namespace
+
+at::Tensor mapSymmetricRegion(const std::string& name, int64_t nbytes, bool create) {
+  TORCH_CHECK(nbytes > 0, "mapSymmetricRegion: size has to be positive, got ", nbytes);
+  const size_t bytes = static_cast<size_t>(nbytes);
+  int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, S_IRUSR | S_IWUSR);
+  TORCH_CHECK(fd >= 0, "oneccl_bindings_for_pytorch: shm_open of ", name, " failed: ", strerror(errno));
+  if (create && ftruncate(fd, nbytes) != 0) {
+    int err = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    TORCH_CHECK(false, "oneccl_bindings_for_pytorch: sizing ", name, " to ", nbytes,
+                " bytes failed: ", strerror(err));
+  }
+  if (!create) {
+    struct stat st;
+    bool large_enough = fstat(fd, &st) == 0 && st.st_size >= nbytes;
+    if (!large_enough) {
+      close(fd);
+      TORCH_CHECK(false, "oneccl_bindings_for_pytorch: ", name, " is smaller than ", nbytes, " bytes");
+    }
+  }
+  void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  TORCH_CHECK(ptr != MAP_FAILED, "oneccl_bindings_for_pytorch: mmap of ", name, " failed: ", strerror(err));
+  return at::from_blob(ptr, {nbytes}, [bytes](void* p) { munmap(p, bytes); },
+                       at::TensorOptions().dtype(at::kByte).device(at::kCPU));
+}
+
+void protectSymmetricRegion(const at::Tensor& view) {
+  const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(view.data_ptr());
+  TORCH_CHECK(view.is_contiguous() && begin % page == 0,
+              "protectSymmetricRegion: expects a contiguous page aligned view");
+  const size_t len = (view.nbytes() + page - 1) / page * page;
+  TORCH_CHECK(mprotect(view.data_ptr(), len, PROT_READ) == 0,
+              "oneccl_bindings_for_pytorch: mprotect failed: ", strerror(errno));
+}
+
+void unlinkSymmetricRegion(const std::string& name) {
+  if (shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+    TORCH_WARN("oneccl_bindings_for_pytorch: shm_unlink of ", name, " failed: ", strerror(errno));
+  }
+}
+
+void symmetricSignal(at::Tensor& flags, int64_t index, int64_t value) {
+  __atomic_store_n(flagAt(flags, index), value, __ATOMIC_RELEASE);
+}
+
+void symmetricWait(const at::Tensor& flags, int64_t index, int64_t value, double timeout) {
+  const int64_t* flag = flagAt(flags, index);
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t spins = 0; __atomic_load_n(flag, __ATOMIC_ACQUIRE) < value; spins++) {
+    // Spin briefly for the fast path, then give the core to the peer ranks,
+    // which may well share it.
+    if (spins < 1024) {
+#if defined(__x86_64__)
+      __builtin_ia32_pause();
+#endif
+      continue;
+    }
+    sched_yield();
+    if (timeout >= 0 && (spins & 1023) == 0 &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout) {
+      TORCH_CHECK(false, "oneccl_bindings_for_pytorch: symmetric wait for flag ", index, " to reach ", value,
+                  " timed out after ", timeout, " s, it is at ", __atomic_load_n(flag, __ATOMIC_ACQUIRE));
+    }
+  }
+}
+
+} // namespace oneccl_bindings_for_pytorch
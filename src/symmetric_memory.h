@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <ATen/ATen.h>
+
+// Shared memory regions mapped by all the ranks of a node, the host side
+// counterpart of the peer IPC buffers the XPU allreduce exchanges. Python's
+// symmetric_empty sets them up for the local ranks of a group; C++ extensions
+// get the mapped region as a tensor and address the peers' copies in it.
+namespace oneccl_bindings_for_pytorch {
+
+// uint8 CPU tensor over the POSIX shared memory object `name` of `nbytes`,
+// which the mapping keeps alive until the tensor is freed. With `create`
+// the object must not exist yet and is created zero filled, otherwise it has
+// to exist with at least `nbytes`.
+at::Tensor mapSymmetricRegion(const std::string& name, int64_t nbytes, bool create);
+
+// Makes the pages of `view`, a page aligned part of a mapped region, read
+// only in this process, so that stray writes to memory the other ranks read
+// fault instead of corrupting it.
+void protectSymmetricRegion(const at::Tensor& view);
+
+// Removes `name` so that the memory goes away with the last mapping. Once all
+// the ranks mapped it, the creator unlinks it so that nothing outlives the job.
+void unlinkSymmetricRegion(const std::string& name);
+
+// Release store of `value` into the int64 flag `flags[index]`, which lives in
+// a symmetric region. Each flag is meant to have a single writer.
+void symmetricSignal(at::Tensor& flags, int64_t index, int64_t value);
+
+// Spins until `flags[index]` reaches `value`, with acquire ordering, so that
+// the writes the signaling rank made before its signal are visible. Throws
+// after `timeout` seconds, a negative `timeout` waits forever.
+void symmetricWait(const at::Tensor& flags, int64_t index, int64_t value, double timeout);
+
+} // namespace oneccl_bindings_for_pytorch
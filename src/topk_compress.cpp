@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include <ATen/Parallel.h>
+#include <c10/util/Exception.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CCL_TOPK_HAS_AVX512 1
+#endif
+
+#include "topk_compress.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+// Chunks handled by one intra-op task.
+constexpr int64_t kTopKGrainChunks = 4;
+// Magnitudes sampled to estimate the threshold of a chunk.
+constexpr int64_t kTopKSamples = 256;
+constexpr uint32_t kAbsMask = 0x7fffffffu;
+constexpr uint32_t kInfBits = 0x7f800000u;
+
+int64_t numChunks(int64_t numel) {
+  return (numel + kTopKChunkElems - 1) / kTopKChunkElems;
+}
+
+int64_t chunkLen(int64_t numel, int64_t c) {
+  return std::min(kTopKChunkElems, numel - c * kTopKChunkElems);
+}
+
+int64_t chunkCount(int64_t len, double ratio) {
+  return std::min<int64_t>(len, std::max<int64_t>(1, static_cast<int64_t>(std::ceil(len * ratio))));
+}
+
+// Entries of the chunks before chunk `c`, all of which are full sized.
+int64_t chunkOffset(int64_t c, double ratio) {
+  return c * chunkCount(kTopKChunkElems, ratio);
+}
+
+// Magnitude of a float as ordered integer bits. NaNs rank as zeros.
+inline uint32_t magnitudeBits(float v) {
+  uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  bits &= kAbsMask;
+  return bits > kInfBits ? 0 : bits;
+}
+
+// Takes the entries above `threshold`, and the first `ties` entries equal
+// to it, out of the chunk starting at element `begin`. Returns how many were
+// taken.
+int64_t takeScalar(float* acc, int64_t begin, int64_t len, uint32_t threshold, int64_t ties,
+                   int32_t* indices, float* values) {
+  int64_t n = 0;
+  for (int64_t i = 0; i < len; i++) {
+    const uint32_t bits = magnitudeBits(acc[i]);
+    if (bits > threshold || (bits == threshold && ties > 0)) {
+      ties -= bits == threshold;
+      indices[n] = static_cast<int32_t>(begin + i);
+      values[n++] = acc[i];
+      acc[i] = 0.f;
+    }
+  }
+  return n;
+}
+
+// Writes the magnitude bits of the chunk to `bits` and those of at least
+// `estimate` to `candidates`. Returns the number of candidates.
+int64_t collectScalar(const float* acc, int64_t len, uint32_t estimate, uint32_t* bits, uint32_t* candidates) {
+  int64_t n = 0;
+  for (int64_t i = 0; i < len; i++) {
+    bits[i] = magnitudeBits(acc[i]);
+    candidates[n] = bits[i];
+    n += bits[i] >= estimate;
+  }
+  return n;
+}
+
+#ifdef CCL_TOPK_HAS_AVX512
+
+__attribute__((target("avx512f,popcnt")))
+int64_t collectAvx512(const float* acc, int64_t len, uint32_t estimate, uint32_t* bits, uint32_t* candidates) {
+  const __m512i abs_mask = _mm512_set1_epi32(kAbsMask);
+  const __m512i inf = _mm512_set1_epi32(kInfBits);
+  const __m512i est = _mm512_set1_epi32(estimate);
+  int64_t n = 0, i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i v = _mm512_and_si512(_mm512_loadu_si512(acc + i), abs_mask);
+    v = _mm512_maskz_mov_epi32(_mm512_cmple_epu32_mask(v, inf), v);
+    _mm512_storeu_si512(bits + i, v);
+    __mmask16 mask = _mm512_cmpge_epu32_mask(v, est);
+    _mm512_mask_compressstoreu_epi32(candidates + n, mask, v);
+    n += __builtin_popcount(mask);
+  }
+  return n + collectScalar(acc + i, len - i, estimate, bits + i, candidates + n);
+}
+
+__attribute__((target("avx512f,popcnt")))
+int64_t takeAvx512(float* acc, int64_t begin, int64_t len, uint32_t threshold, int64_t ties,
+                   int32_t* indices, float* values) {
+  const __m512i abs_mask = _mm512_set1_epi32(kAbsMask);
+  const __m512i inf = _mm512_set1_epi32(kInfBits);
+  const __m512i thr = _mm512_set1_epi32(threshold);
+  const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  int64_t n = 0, i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512 v = _mm512_loadu_ps(acc + i);
+    __m512i bits = _mm512_and_si512(_mm512_castps_si512(v), abs_mask);
+    // NaNs rank as zeros, as in magnitudeBits.
+    bits = _mm512_maskz_mov_epi32(_mm512_cmple_epu32_mask(bits, inf), bits);
+    __mmask16 mask = _mm512_cmpgt_epu32_mask(bits, thr);
+    __mmask16 equal = ties > 0 ? _mm512_cmpeq_epi32_mask(bits, thr) : 0;
+    for (; equal && ties > 0; ties--) {
+      mask |= equal & -equal;
+      equal &= equal - 1;
+    }
+    if (mask) {
+      __m512i idx = _mm512_add_epi32(lanes, _mm512_set1_epi32(static_cast<int32_t>(begin + i)));
+      _mm512_mask_compressstoreu_epi32(indices + n, mask, idx);
+      _mm512_mask_compressstoreu_ps(values + n, mask, v);
+      _mm512_mask_storeu_ps(acc + i, mask, _mm512_setzero_ps());
+      n += __builtin_popcount(mask);
+    }
+  }
+  return n + takeScalar(acc + i, begin + i, len - i, threshold, ties, indices + n, values + n);
+}
+
+bool hasAvx512() {
+  static const bool supported = __builtin_cpu_supports("avx512f");
+  return supported;
+}
+
+#endif
+
+int64_t collect(const float* acc, int64_t len, uint32_t estimate, uint32_t* bits, uint32_t* candidates) {
+#ifdef CCL_TOPK_HAS_AVX512
+  if (hasAvx512()) {
+    return collectAvx512(acc, len, estimate, bits, candidates);
+  }
+#endif
+  return collectScalar(acc, len, estimate, bits, candidates);
+}
+
+// Magnitude bits of the k-th largest magnitude of the chunk, and in `ties`
+// how many entries equal to it belong to the top k. A sample gives
+// an estimate a little below it, the magnitudes above the estimate are
+// gathered in one vector pass and the exact threshold is selected among
+// them, or among the whole chunk when the estimate was too high.
+uint32_t chunkThreshold(const float* acc, int64_t len, int64_t k, int64_t* ties) {
+  uint32_t bits[kTopKChunkElems];
+  uint32_t candidates[kTopKChunkElems];
+  uint32_t estimate = 0;
+  const int64_t rank = k * kTopKSamples * 2 / len + 2;
+  if (len >= kTopKSamples * 4 && rank < kTopKSamples) {
+    uint32_t sample[kTopKSamples];
+    for (int64_t j = 0; j < kTopKSamples; j++) {
+      sample[j] = magnitudeBits(acc[j * len / kTopKSamples]);
+    }
+    std::nth_element(sample, sample + rank, sample + kTopKSamples, std::greater<uint32_t>());
+    estimate = sample[rank];
+  }
+  int64_t n = collect(acc, len, estimate, bits, candidates);
+  uint32_t* first = candidates;
+  if (n < k) {
+    first = bits;
+    n = len;
+  }
+  std::nth_element(first, first + k - 1, first + n, std::greater<uint32_t>());
+  const uint32_t threshold = first[k - 1];
+  *ties = k - std::count_if(first, first + k - 1, [=](uint32_t bits) { return bits > threshold; });
+  return threshold;
+}
+
+int64_t take(float* acc, int64_t begin, int64_t len, uint32_t threshold, int64_t ties,
+             int32_t* indices, float* values) {
+#ifdef CCL_TOPK_HAS_AVX512
+  if (hasAvx512()) {
+    return takeAvx512(acc, begin, len, threshold, ties, indices, values);
+  }
+#endif
+  return takeScalar(acc, begin, len, threshold, ties, indices, values);
+}
+
+} // namespace
+
+int64_t topkCount(int64_t numel, double ratio) {
+  TORCH_CHECK(ratio > 0 && ratio <= 1, "top-k ratio must be in (0, 1]");
+  const int64_t chunks = numChunks(numel);
+  if (chunks == 0) {
+    return 0;
+  }
+  return chunkOffset(chunks - 1, ratio) + chunkCount(chunkLen(numel, chunks - 1), ratio);
+}
+
+void topkSelect(float* acc, int64_t numel, double ratio, int32_t* indices, float* values) {
+  TORCH_CHECK(numel <= std::numeric_limits<int32_t>::max(), "top-k allreduce supports up to 2^31 - 1 elements");
+  at::parallel_for(0, numChunks(numel), kTopKGrainChunks, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      const int64_t start = c * kTopKChunkElems;
+      const int64_t len = chunkLen(numel, c);
+      const int64_t k = chunkCount(len, ratio);
+      const int64_t offset = chunkOffset(c, ratio);
+      float* chunk = acc + start;
+      int64_t ties = 0;
+      const uint32_t threshold = chunkThreshold(chunk, len, k, &ties);
+      take(chunk, start, len, threshold, ties, indices + offset, values + offset);
+    }
+  });
+}
+
+void topkMerge(const int32_t* packed, int64_t world_size, int64_t numel, double ratio, float* out) {
+  const int64_t count = topkCount(numel, ratio);
+  // Every rank's entries of one chunk fall into that chunk, so chunks are
+  // merged independently and always in rank order.
+  at::parallel_for(0, numChunks(numel), kTopKGrainChunks, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      const int64_t start = c * kTopKChunkElems;
+      const int64_t len = chunkLen(numel, c);
+      const int64_t k = chunkCount(len, ratio);
+      const int64_t offset = chunkOffset(c, ratio);
+      for (int64_t r = 0; r < world_size; r++) {
+        const int32_t* indices = packed + r * 2 * count + offset;
+        const float* values = reinterpret_cast<const float*>(packed + r * 2 * count + count) + offset;
+        for (int64_t j = 0; j < k; j++) {
+          TORCH_CHECK(indices[j] >= start && indices[j] < start + len, "top-k allreduce: corrupt index");
+          out[indices[j]] += values[j];
+        }
+      }
+    }
+  });
+}
+
+bool topkUsesSimd() {
+#ifdef CCL_TOPK_HAS_AVX512
+  return hasAvx512();
+#else
+  return false;
+#endif
+}
+
+at::Tensor TopKResiduals::get(int64_t key, int64_t numel) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& residual = residuals_[key];
+  if (!residual.defined() || residual.numel() != numel) {
+    residual = at::zeros({numel}, at::kFloat);
+  }
+  return residual;
+}
+
+void TopKResiduals::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  residuals_.clear();
+}
+
+} // namespace oneccl_bindings_for_pytorch
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include <ATen/ATen.h>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Top-k sparsification of fp32 gradients with error feedback. The gradient
+// is split in chunks of kTopKChunkElems elements and every chunk contributes
+// its ceil(len * ratio) largest magnitude entries, so each rank sends the
+// same number of entries for the same numel and ratio.
+constexpr int64_t kTopKChunkElems = 4096;
+
+// Entries selected from `numel` elements.
+int64_t topkCount(int64_t numel, double ratio);
+
+// Moves the selected entries of every chunk of `acc` to `indices` and
+// `values`, which hold topkCount entries, and zeros them in `acc`, which is
+// left holding the residual.
+void topkSelect(float* acc, int64_t numel, double ratio, int32_t* indices, float* values);
+
+// Sums the selections of `world_size` ranks into the zero filled `out`.
+// `packed` holds per rank topkCount indices followed by as many values.
+void topkMerge(const int32_t* packed, int64_t world_size, int64_t numel, double ratio, float* out);
+
+// Whether the AVX-512 kernel is used on this CPU.
+bool topkUsesSimd();
+
+// fp32 error feedback buffers of a group, keyed by the caller, e.g. the DDP
+// bucket index.
+class TopKResiduals {
+public:
+  // The residual of `key`, zero filled when new or when `numel` changed.
+  at::Tensor get(int64_t key, int64_t numel);
+  void clear();
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<int64_t, at::Tensor> residuals_;
+};
+
+} // namespace oneccl_bindings_for_pytorch
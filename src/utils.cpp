@@ -43,6 +43,55 @@ std::map<c10d::ReduceOp, ccl::reduction> cclOps =
     {ReduceOp::PRODUCT, ccl::reduction::prod},
   };
 
+namespace {
+
+std::string reduceOpName(const c10d::ReduceOp& op) {
+#if TORCH_VERSION_MAJOR > 1 || TORCH_VERSION_MINOR >= 13
+  switch (op.op_) {
+    case ReduceOp::AVG: return "AVG";
+    case ReduceOp::PREMUL_SUM: return "PREMUL_SUM";
+    case ReduceOp::BAND: return "BAND";
+    case ReduceOp::BOR: return "BOR";
+    case ReduceOp::BXOR: return "BXOR";
+    default: return std::to_string(static_cast<int>(op.op_));
+  }
+#else
+  return std::to_string(static_cast<int>(op));
+#endif
+}
+
+} // namespace
+
+ccl::reduction cclOp(const c10d::ReduceOp& op) {
+  auto it = cclOps.find(op);
+  TORCH_CHECK(it != cclOps.end(), "oneccl_bindings_for_pytorch: ReduceOp ", reduceOpName(op),
+              " is not supported by this collective, use SUM, PRODUCT, MIN or MAX");
+  return it->second;
+}
+
+#if TORCH_VERSION_MAJOR > 1
+bool isPremulSum(const c10d::ReduceOp& op) {
+  return op == ReduceOp::PREMUL_SUM;
+}
+
+at::Tensor premulFactor(const c10d::ReduceOp& op, const at::Tensor& like) {
+  auto supplement = dynamic_cast<c10d::NCCLPreMulSumSupplement*>(op.supplement_.get());
+  TORCH_CHECK(supplement != nullptr, "PREMUL_SUM without a factor");
+  if (supplement->tensor_factor.defined()) {
+    return supplement->tensor_factor.to(like.device(), like.scalar_type()).reshape({});
+  }
+  return at::scalar_tensor(supplement->double_factor, like.options());
+}
+#else
+bool isPremulSum(const c10d::ReduceOp& op) {
+  return false;
+}
+
+at::Tensor premulFactor(const c10d::ReduceOp& op, const at::Tensor& like) {
+  TORCH_CHECK(false, "PREMUL_SUM needs torch 2.0 or later");
+}
+#endif
+
 std::map<at::ScalarType, ccl::datatype> cclDatatypes =
   {
     {at::kByte, ccl::datatype::uint8},
@@ -32,6 +32,7 @@
 #pragma once
 
 #include <unistd.h>
+#include <sstream>
 #include <thread>
 #include <ATen/detail/FunctionTraits.h>
 #include <ATen/record_function.h>
@@ -46,9 +47,14 @@
 
 #include <ccl_comm_collector.h>
 #include "ProcessGroupCCL.hpp"
+#include "hugepage_allocator.h"
+#include "mpsc_queue.h"
 
 
 constexpr uint64_t kSynchronizeBusyWaitMicro = 10; // 50us
+// Ring slots of the progress thread's queue, further works go to its
+// overflow list.
+constexpr size_t kWorkQueueCapacity = 16384;
 
 #define CCL_CHECK(cmd)                                               \
   do {                                                               \
@@ -83,6 +89,18 @@ namespace oneccl_bindings_for_pytorch {
 using c10d::ProcessGroupCCL;
 
 extern std::map<c10d::ReduceOp, ccl::reduction> cclOps;
+
+// oneCCL reduction of `op`, raising a c10::Error which names the op for
+// the ones oneCCL has no reduction for, e.g. AVG.
+ccl::reduction cclOp(const c10d::ReduceOp& op);
+
+// PREMUL_SUM, e.g. from dist._make_nccl_premul_sum, is a SUM of the inputs
+// scaled by the op's factor. oneCCL has no such reduction, so the ops scale
+// staging copies of the inputs by this factor and run a SUM, which leaves
+// the caller's tensors untouched until the collective writes its result.
+// NCCLPreMulSumSupplement is only used from torch 2.0 on.
+bool isPremulSum(const c10d::ReduceOp& op);
+at::Tensor premulFactor(const c10d::ReduceOp& op, const at::Tensor& like);
 extern std::map<at::ScalarType, ccl::datatype> cclDatatypes;
 
 // Get the deviceList String from the list of devices
@@ -103,7 +121,7 @@ inline at::Tensor newLikeFlat(std::vector<at::Tensor>& tensors) {
   at::DeviceGuard deviceGuard(t.device());
   std::vector<int64_t> sizes{static_cast<int64_t>(tensors.size())};
   sizes.insert(sizes.end(), t.sizes().begin(), t.sizes().end());
-  return at::empty(sizes, t.options());
+  return oneccl_bindings_for_pytorch::emptyCommBuffer(sizes, t.options());
 }
 
 template <typename ccl_fn_type>
@@ -257,6 +275,9 @@ public:
   }
 
   bool isCompleted() override {
+    if (!this->launched_.load(std::memory_order_acquire)) {
+      return false;
+    }
     for(auto& ret : rets) {
       bool flag;
       ccl::event& req = get_event_from_ret_<ret_t>(ret);
@@ -322,6 +343,13 @@ public:
     synchronizeInternal(kNoTimeout);
   }
 
+  void releaseResources() override {
+    inputs.clear();
+    inputs.shrink_to_fit();
+    f.reset();
+    AsyncWorkCCL::releaseResources();
+  }
+
 protected:
   std::vector<ccl::event>& get_ccl_event()
   {
@@ -333,7 +361,7 @@ protected:
     if (rets.empty()) {
       auto& outputs = outputTensors_;
       for (size_t i = 0; i < inputs.size(); i++) {
-        CCL_CHECK(rets.push_back(f(inputs[i], outputs[i], attr, comms.comms[i], comms.streams[i + INDEX]...)));
+        CCL_CHECK(rets.push_back((*f)(inputs[i], outputs[i], attr, comms.comms[i], comms.streams[i + INDEX]...)));
       }
     }
     else {
@@ -353,7 +381,7 @@ protected:
       // Some primitives have empty input(scatter), so we get the size after checking size of input and output.
       auto size = inputs.empty()?outputs.size():inputs.size();
       for (size_t i = 0; i < size; i++) {
-        CCL_CHECK(rets.push_back(f(inputs[i], outputs[i], attr, comms.comms[0], comms.streams[0 + INDEX]...)));
+        CCL_CHECK(rets.push_back((*f)(inputs[i], outputs[i], attr, comms.comms[0], comms.streams[0 + INDEX]...)));
       }
     }
     else {
@@ -366,7 +394,7 @@ protected:
     if (rets.empty()) {
       auto& outputs = outputTensors_;
       for (size_t i = 0; i < inputs.size(); i++) {
-        CCL_CHECK(rets.push_back(f(inputs[i], outputs[i], attr, comms.comms[i], comms.streams[i], comms.torch_streams[i])));
+        CCL_CHECK(rets.push_back((*f)(inputs[i], outputs[i], attr, comms.comms[i], comms.streams[i], comms.torch_streams[i])));
       }
     }
     else {
@@ -381,7 +409,7 @@ protected:
       // Some primitives have empty input(scatter), so we get the size after checking size of input and output.
       auto size = inputs.empty()?outputs.size():inputs.size();
       for (size_t i = 0; i < size; i++) {
-        CCL_CHECK(rets.push_back(f(inputs[i], outputs[i], attr, comms.comms[i], comms.streams[i], comms.torch_streams[i])));
+        CCL_CHECK(rets.push_back((*f)(inputs[i], outputs[i], attr, comms.comms[i], comms.streams[i], comms.torch_streams[i])));
       }
     }
     else {
@@ -402,7 +430,8 @@ protected:
     return ret;
   }
 
-  RunF f;
+  // Reset by releaseResources() to drop the tensors captured by the op.
+  c10::optional<RunF> f;
   CommType& comms;
   attr_t attr;
   // Keep the reference to the tensor.
@@ -480,6 +509,9 @@ public:
   }
 
   bool isCompleted() override {
+    if (!this->launched_.load(std::memory_order_acquire)) {
+      return false;
+    }
     for(auto& ret : rets) {
       bool flag;
       ccl::event& req = get_event_from_ret_<ret_t>(ret);
@@ -625,6 +657,65 @@ protected:
   std::chrono::time_point<std::chrono::steady_clock> workStartTime_;
 };
 
+inline int64_t comm_bytes(const at::Tensor& tensor) {
+  return tensor.numel() * tensor.element_size();
+}
+
+inline int64_t comm_bytes(const std::vector<at::Tensor>& tensors) {
+  int64_t bytes = 0;
+  for (const auto& tensor : tensors) {
+    bytes += comm_bytes(tensor);
+  }
+  return bytes;
+}
+
+inline void comm_sizes(std::ostream& os, const at::Tensor& tensor) {
+  os << tensor.sizes();
+}
+
+inline void comm_sizes(std::ostream& os, const std::vector<at::Tensor>& tensors) {
+  os << "[";
+  for (size_t i = 0; i < tensors.size(); i++) {
+    os << (i ? ", " : "") << tensors[i].sizes();
+  }
+  os << "]";
+}
+
+// Register the work with the group's stats file and watchdog, if enabled.
+template <typename input_t>
+void record_work_issue(ProcessGroupCCL& pg_ccl,
+                       ProcessGroupCCL::AsyncWorkCCL& work,
+                       c10d::OpType op_type,
+                       const std::vector<input_t>& inputs,
+                       const char* prof_title) {
+  if (!pg_ccl.commStats_ && !pg_ccl.watchdog_) {
+    return;
+  }
+  int64_t bytes = 0;
+  for (const auto& input : inputs) {
+    bytes += comm_bytes(input);
+  }
+  work.issueTime_ = std::chrono::steady_clock::now();
+  if (pg_ccl.commStats_) {
+    work.commStats_ = pg_ccl.commStats_;
+    work.statsSeq_ = pg_ccl.commStats_->recordIssue(static_cast<int>(op_type), bytes);
+  }
+  if (pg_ccl.watchdog_) {
+    // The inputs may be released before the op is reported, keep their sizes.
+    std::ostringstream sizes;
+    sizes << "[";
+    for (size_t i = 0; i < inputs.size(); i++) {
+      sizes << (i ? ", " : "");
+      comm_sizes(sizes, inputs[i]);
+    }
+    sizes << "]";
+    work.watchdog_ = pg_ccl.watchdog_;
+    work.watchdogSeq_ = pg_ccl.watchdog_->recordIssue(
+        static_cast<int>(op_type), prof_title ? prof_title : c10d::opTypeToString(op_type),
+        sizes.str(), bytes, work.issueTime_);
+  }
+}
+
 template <template<typename, typename, typename, typename, typename> class WorkCCL,
           typename RunF, typename CommType, typename InputType, typename OutputType, typename attr_t>
 c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> make_work_ccl(const std::vector<InputType>& inputs,
@@ -662,6 +753,16 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> make_work_p2p(const std::vecto
   return ret_ptr;
 }
 
+// Attributes for a later stage of a staged op, carrying over what collective()
+// set on the attributes of its first stage.
+template <typename stage_attr_t, typename attr_t>
+stage_attr_t stage_attr(const attr_t& attr) {
+  stage_attr_t ret = ccl::create_operation_attr<stage_attr_t>();
+  ret.template set<ccl::operation_attr_id::priority>(
+      attr.template get<ccl::operation_attr_id::priority>());
+  return ret;
+}
+
 template <Comms& (*get_ccl_fn)(c10d::ProcessGroupCCL& pg_ccl, const std::string& devices_key, const std::vector<at::Device>& devices, c10d::OpType op_type, int p2pRank, bool isSendRecvSelf),
         template<typename, typename, typename, typename, typename> class WorkCCL,
         typename fn, typename pre_process, typename post_process, typename input_t, typename output_t>
@@ -677,6 +778,9 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> collective(
   using traits = function_traits<fn>;
   using attr_t = typename traits::template arg<2>::type;
   attr_t attr = ccl::create_operation_attr<attr_t>();
+  if (pg_ccl.op_priority_ > 0) {
+    attr.template set<ccl::operation_attr_id::priority>(static_cast<size_t>(pg_ccl.op_priority_));
+  }
 
   std::vector<at::Device> devices;
   if (inputs.empty() && outputs.empty()) {
@@ -698,12 +802,27 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> collective(
     pg_ccl.coalescedDevices_.push_back(devices[0]);
   }
 
+  // Coalesced works are only launched at the end of the block, waiting for
+  // them here would never return.
+  std::shared_ptr<InFlightLimiter::Slot> in_flight_slot;
+  if (pg_ccl.inFlightLimiter_ && devices[0].is_cpu() && !pg_ccl.is_coalescing_) {
+    in_flight_slot = pg_ccl.inFlightLimiter_->acquire();
+  }
+
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
   work = make_work_ccl<WorkCCL>(inputs, outputs, fun, comms, attr, pg_ccl.timeout, pg_ccl.getRank(), op_type, prof_title);
 
   // Set appropriate work parameters.
   work->blockingWait_ = pg_ccl.blockingWait_;
   work->useSameStream_ = pg_ccl.useSameStream_;
+  // XPU futures are marked against the communication streams of the calling
+  // thread, so only CPU works hand their callbacks to the executor.
+  if (devices[0].is_cpu()) {
+    work->callbackExecutor_ = pg_ccl.callbackExecutor_;
+    work->asyncSubmit_ = pg_ccl.asyncSubmit_;
+  }
+  work->inFlightSlot_ = std::move(in_flight_slot);
+  record_work_issue(pg_ccl, *work, op_type, inputs, prof_title);
   return work;
 }
 
@@ -724,6 +843,9 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> pointToPoint(
   using traits = function_traits<fn>;
   using attr_t = typename traits::template arg<2>::type;
   attr_t attr = ccl::create_operation_attr<attr_t>();
+  if (pg_ccl.op_priority_ > 0) {
+    attr.template set<ccl::operation_attr_id::priority>(static_cast<size_t>(pg_ccl.op_priority_));
+  }
   const auto devices = get_device_list(inputs);
   std::string key;
   int p2pRank = 0, p2pTargetRank = 0;
@@ -754,6 +876,7 @@ c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> pointToPoint(
   c10::intrusive_ptr<ProcessGroupCCL::AsyncWorkCCL> work;
 
   work = make_work_p2p<WorkP2P>(inputs, outputs, peer, fun, comms, attr, pg_ccl.timeout, pg_ccl.getRank(), op_type, prof_title);
+  record_work_issue(pg_ccl, *work, op_type, inputs, prof_title);
 
   return work;
 }
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <signal.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include <c10/util/Exception.h>
+
+#include "watchdog.h"
+
+namespace oneccl_bindings_for_pytorch {
+
+namespace {
+
+std::atomic<int64_t> nextGroupIndex{0};
+// Bumped by the dump signal, every watchdog dumps once per new value.
+std::atomic<uint64_t> dumpRequests{0};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the signal handler needs a lock free counter");
+
+void dumpSignalHandler(int) {
+  dumpRequests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void installDumpSignal() {
+  static std::once_flag flag;
+  std::call_once(flag, []() {
+    const char* env = std::getenv(TORCH_CCL_WATCHDOG_DUMP_SIGNAL);
+    int sig = env ? std::atoi(env) : 0;
+    if (sig <= 0) {
+      return;
+    }
+    struct sigaction action = {};
+    action.sa_handler = dumpSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(sig, &action, nullptr) != 0) {
+      TORCH_WARN("oneccl_bindings_for_pytorch: cannot install the in-flight dump handler for signal ", sig);
+    }
+  });
+}
+
+int64_t envInt(const char* name, int64_t default_value) {
+  const char* env = std::getenv(name);
+  return env ? std::atoll(env) : default_value;
+}
+
+int latencyBucket(uint64_t us) {
+  int bucket = 0;
+  while (us > 1 && bucket < 31) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+} // namespace
+
+std::shared_ptr<CommWatchdog> CommWatchdog::create(int rank, int size, std::chrono::milliseconds timeout) {
+  int64_t interval = envInt(TORCH_CCL_WATCHDOG_INTERVAL_MS, 0);
+  if (interval <= 0) {
+    return nullptr;
+  }
+  const char* factor_env = std::getenv(TORCH_CCL_SLOW_OP_FACTOR);
+  double factor = factor_env ? std::atof(factor_env) : 4.0;
+  TORCH_CHECK(factor > 0, "oneccl_bindings_for_pytorch: ", TORCH_CCL_SLOW_OP_FACTOR, " must be positive");
+  int64_t slow_min = envInt(TORCH_CCL_SLOW_OP_MIN_MS, 1000);
+  installDumpSignal();
+  return std::make_shared<CommWatchdog>(rank, size, std::chrono::milliseconds(interval), timeout, factor,
+                                        std::chrono::milliseconds(std::max<int64_t>(slow_min, 0)));
+}
+
+CommWatchdog::CommWatchdog(int rank,
+                           int size,
+                           std::chrono::milliseconds interval,
+                           std::chrono::milliseconds timeout,
+                           double slow_factor,
+                           std::chrono::milliseconds slow_min)
+    : rank_(rank),
+      size_(size),
+      group_index_(nextGroupIndex++),
+      interval_(interval),
+      timeout_(timeout),
+      slow_factor_(slow_factor),
+      slow_min_(slow_min),
+      dump_generation_(dumpRequests.load()) {
+  thread_ = std::thread(&CommWatchdog::watchLoop, this);
+}
+
+CommWatchdog::~CommWatchdog() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+uint64_t CommWatchdog::recordIssue(int op_type,
+                                   std::string name,
+                                   std::string sizes,
+                                   int64_t bytes,
+                                   std::chrono::steady_clock::time_point issue_time) {
+  const int slot = (op_type >= 0 && op_type < kOpSlots) ? op_type : kOpSlots - 1;
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t seq = next_seq_++;
+  in_flight_.emplace(seq, InFlightOp{seq, slot, std::move(name), std::move(sizes), bytes, issue_time, 0});
+  return seq;
+}
+
+void CommWatchdog::recordCompletion(uint64_t seq) {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = in_flight_.find(seq);
+  if (it == in_flight_.end()) {
+    return;
+  }
+  const auto& op = it->second;
+  uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(now - op.issue_time).count();
+  if (op.reports > 0) {
+    TORCH_WARN("oneccl_bindings_for_pytorch: [Rank ", rank_, "] slow op ", op.name, " seq ", seq,
+               " of group ", group_index_, " completed after ", us / 1000, " ms");
+  }
+  latency_hist_[op.op_type][latencyBucket(us)]++;
+  completed_[op.op_type]++;
+  in_flight_.erase(it);
+}
+
+std::chrono::milliseconds CommWatchdog::slowThresholdLocked(int op_type) const {
+  std::chrono::milliseconds threshold = slow_min_;
+  if (completed_[op_type] >= kMinSamples) {
+    // Upper bound of the bucket which holds the p99 latency.
+    uint64_t target = completed_[op_type] - completed_[op_type] / 100;
+    uint64_t seen = 0;
+    int bucket = 0;
+    for (; bucket < kLatencyBuckets - 1; bucket++) {
+      seen += latency_hist_[op_type][bucket];
+      if (seen >= target) {
+        break;
+      }
+    }
+    auto p99 = std::chrono::microseconds(uint64_t(1) << (bucket + 1));
+    threshold = std::max(threshold, std::chrono::duration_cast<std::chrono::milliseconds>(p99 * slow_factor_));
+  }
+  // Stay well below the hard timeout, otherwise the watchdog only reports
+  // what the timeout is about to report anyway.
+  if (timeout_.count() > 0) {
+    threshold = std::min(threshold, timeout_ / 2);
+  }
+  return threshold;
+}
+
+std::chrono::milliseconds CommWatchdog::slowThreshold(int op_type) {
+  const int slot = (op_type >= 0 && op_type < kOpSlots) ? op_type : kOpSlots - 1;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slowThresholdLocked(slot);
+}
+
+std::string CommWatchdog::dumpLocked(std::chrono::steady_clock::time_point now) const {
+  std::ostringstream os;
+  os << "[Rank " << rank_ << "/" << size_ << "] group " << group_index_ << ": " << in_flight_.size()
+     << " ops in flight";
+  // in_flight_ is ordered by sequence number, which is also the issue order.
+  for (const auto& entry : in_flight_) {
+    const auto& op = entry.second;
+    os << "\n  seq " << op.seq << " " << op.name << " sizes " << op.sizes << " bytes " << op.bytes << " age "
+       << std::chrono::duration_cast<std::chrono::milliseconds>(now - op.issue_time).count() << " ms";
+  }
+  return os.str();
+}
+
+std::string CommWatchdog::dumpInFlight() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dumpLocked(std::chrono::steady_clock::now());
+}
+
+void CommWatchdog::watchLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    cv_.wait_for(lock, interval_, [&] { return stop_; });
+    if (stop_) {
+      break;
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (auto& entry : in_flight_) {
+      auto& op = entry.second;
+      auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - op.issue_time);
+      auto threshold = slowThresholdLocked(op.op_type);
+      // Report again each time the age doubles, so a hung op is not logged
+      // on every scan.
+      if (age < threshold * (int64_t(1) << std::min(op.reports, 30))) {
+        continue;
+      }
+      op.reports++;
+      TORCH_WARN("oneccl_bindings_for_pytorch: [Rank ", rank_, "] slow op ", op.name, " seq ", op.seq,
+                 " of group ", group_index_, " (size ", size_, ") sizes ", op.sizes, " bytes ", op.bytes,
+                 " in flight for ", age.count(), " ms, slow threshold ", threshold.count(), " ms, ",
+                 in_flight_.size(), " ops in flight");
+    }
+    uint64_t requests = dumpRequests.load(std::memory_order_relaxed);
+    if (requests != dump_generation_) {
+      dump_generation_ = requests;
+      TORCH_WARN("oneccl_bindings_for_pytorch: in-flight ops\n", dumpLocked(now));
+    }
+  }
+}
+
+} // namespace oneccl_bindings_for_pytorch
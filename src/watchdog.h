@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020-2021, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace oneccl_bindings_for_pytorch {
+
+// Environment variables of the slow op watchdog.
+// Scan period of the watchdog in milliseconds, 0 disables it.
+constexpr const char* TORCH_CCL_WATCHDOG_INTERVAL_MS = "TORCH_CCL_WATCHDOG_INTERVAL_MS";
+// An op is slow once it is in flight for this many times the p99 latency of
+// its op type...
+constexpr const char* TORCH_CCL_SLOW_OP_FACTOR = "TORCH_CCL_SLOW_OP_FACTOR";
+// ... and at least this many milliseconds.
+constexpr const char* TORCH_CCL_SLOW_OP_MIN_MS = "TORCH_CCL_SLOW_OP_MIN_MS";
+// Signal which makes the watchdogs of the process dump their in-flight ops.
+constexpr const char* TORCH_CCL_WATCHDOG_DUMP_SIGNAL = "TORCH_CCL_WATCHDOG_DUMP_SIGNAL";
+
+// Tracks the in-flight works of one process group and reports the ones that
+// take much longer than the ops of the same type usually do, well before
+// they hit the hard timeout.
+class CommWatchdog {
+public:
+  struct InFlightOp {
+    uint64_t seq;
+    int op_type;
+    std::string name;
+    std::string sizes;
+    int64_t bytes;
+    std::chrono::steady_clock::time_point issue_time;
+    // Number of times the op was reported as slow.
+    int reports;
+  };
+
+  // Returns null unless TORCH_CCL_WATCHDOG_INTERVAL_MS is positive.
+  static std::shared_ptr<CommWatchdog> create(int rank, int size, std::chrono::milliseconds timeout);
+
+  CommWatchdog(int rank,
+               int size,
+               std::chrono::milliseconds interval,
+               std::chrono::milliseconds timeout,
+               double slow_factor,
+               std::chrono::milliseconds slow_min);
+  ~CommWatchdog();
+
+  // Register an op and return its sequence number in the group.
+  uint64_t recordIssue(int op_type,
+                       std::string name,
+                       std::string sizes,
+                       int64_t bytes,
+                       std::chrono::steady_clock::time_point issue_time);
+
+  void recordCompletion(uint64_t seq);
+
+  // Current slow threshold of the op type.
+  std::chrono::milliseconds slowThreshold(int op_type);
+
+  // Human readable table of the in-flight ops, oldest first.
+  std::string dumpInFlight();
+
+private:
+  static constexpr int kOpSlots = 32;
+  static constexpr int kLatencyBuckets = 32;
+  // Completed ops of a type needed before its p99 is trusted.
+  static constexpr uint64_t kMinSamples = 32;
+
+  std::chrono::milliseconds slowThresholdLocked(int op_type) const;
+  std::string dumpLocked(std::chrono::steady_clock::time_point now) const;
+  void watchLoop();
+
+  const int rank_;
+  const int size_;
+  const int64_t group_index_;
+  const std::chrono::milliseconds interval_;
+  const std::chrono::milliseconds timeout_;
+  const double slow_factor_;
+  const std::chrono::milliseconds slow_min_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  uint64_t next_seq_ = 1;
+  std::map<uint64_t, InFlightOp> in_flight_;
+  // Completed latency histograms per op type, bucket i holds [2^i, 2^(i+1)) us.
+  uint64_t latency_hist_[kOpSlots][kLatencyBuckets] = {};
+  uint64_t completed_[kOpSlots] = {};
+  uint64_t dump_generation_ = 0;
+  std::thread thread_;
+};
+
+} // namespace oneccl_bindings_for_pytorch
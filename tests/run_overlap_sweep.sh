@@ -0,0 +1,10 @@
+#!/bin/bash
+# run test_overlap.py over the oneCCL worker counts, with and without
+# pinning the workers away from the compute threads
+NP=${NP:-2}
+for workload in matmul transformer; do
+  for workers in 1 2 4; do
+    mpirun -np $NP python -u test_overlap.py --workload=$workload --ccl_workers=$workers
+    mpirun -np $NP python -u test_overlap.py --workload=$workload --ccl_workers=$workers --pin
+  done
+done
@@ -0,0 +1,13 @@
+#!/bin/bash
+# build the XPU path for the SYCL CPU device and run the xpu tests on it, so
+# that the CCL_SYCL_CPU_DEVICE build is covered on machines without Intel GPU.
+# Needs the oneAPI compiler environment and a PyTorch XPU runtime exposing
+# the CPU device.
+set -e
+cd "$(dirname "$0")/.."
+USE_SYCL_CPU_DEVICE=ON COMPUTE_BACKEND=dpcpp python setup.py install
+cd tests
+export ONEAPI_DEVICE_SELECTOR=opencl:cpu
+NP=${NP:-2}
+python -u test_c10d_ccl.py
+mpirun -np $NP python -u test_allreduce.py
@@ -0,0 +1,94 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--ops', type=int, default=64, help='scalar allreduces per step')
+parser.add_argument('--warm', type=int, default=10, help='#warmup')
+parser.add_argument('--iter', type=int, default=200, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+batched_opts = dist.ProcessGroupCCL.Options()
+batched_opts.batch_allreduce = True
+batched_group = dist.new_group(backend="ccl", pg_options=batched_opts)
+plain_opts = dist.ProcessGroupCCL.Options()
+plain_opts.batch_allreduce = False
+plain_group = dist.new_group(backend="ccl", pg_options=plain_opts)
+
+
+def step(group):
+    # Metrics, loss scaler flags and norms of a training step: many scalars of
+    # mixed dtype and op, reduced asynchronously and waited for at the end.
+    tensors, works = [], []
+    for i in range(args.ops):
+        if i % 8 == 7:
+            t = torch.tensor([rank + i], dtype=torch.int64)
+            op = dist.ReduceOp.MAX
+        else:
+            t = torch.tensor([float(rank + i)])
+            op = dist.ReduceOp.SUM
+        tensors.append(t)
+        works.append(dist.all_reduce(t, op=op, group=group, async_op=True))
+    for w in works:
+        w.wait()
+    return tensors
+
+
+def check(tensors):
+    for i, t in enumerate(tensors):
+        if i % 8 == 7:
+            assert t.item() == size - 1 + i, (i, t)
+        else:
+            assert t.item() == size * i + size * (size - 1) / 2, (i, t)
+
+
+def timed(group):
+    for _ in range(args.warm):
+        check(step(group))
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        step(group)
+    return (time.time() - start) / args.iter
+
+
+# A blocking allreduce and ops of other types in between close the batch.
+t = torch.ones(4)
+dist.all_reduce(t, group=batched_group)
+assert torch.equal(t, torch.full((4,), float(size)))
+a = torch.ones(1)
+w = dist.all_reduce(a, group=batched_group, async_op=True)
+b = torch.ones(1 << 20)
+dist.broadcast(b, 0, group=batched_group)
+w.wait()
+assert a.item() == size
+
+# Polling on one rank only launches nothing, so both batches match.
+c, d = torch.ones(1), torch.ones(1)
+wc = dist.all_reduce(c, group=batched_group, async_op=True)
+if rank == 0:
+    assert not wc.is_completed()
+    wc.get_future()
+wd = dist.all_reduce(d, group=batched_group, async_op=True)
+wd.wait()
+wc.wait()
+assert c.item() == size and d.item() == size
+
+plain = timed(plain_group)
+batched = timed(batched_group)
+if rank == 0:
+    print('{} scalar allreduces per step: {:.1f} us unbatched, {:.1f} us batched, {:.2f}x'.format(
+        args.ops, plain * 1e6, batched * 1e6, plain / batched))
@@ -0,0 +1,62 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--sizes', type=str, default='1024,65536,1048576,16777216', help='number of elements')
+parser.add_argument('--dtype', type=str, default='bf16', choices=['bf16', 'fp16'])
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+dtype = torch.bfloat16 if args.dtype == 'bf16' else torch.float16
+
+
+def run(data, mode):
+    ccl.set_allreduce_fp32_accumulation(mode == 'accum')
+
+    def step():
+        if mode == 'fp32':
+            t = data.float()
+            dist.all_reduce(t)
+            return t.to(dtype)
+        t = data.clone()
+        dist.all_reduce(t)
+        return t
+
+    for _ in range(args.warm):
+        step()
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        out = step()
+    return (time.time() - start) / args.iter, out
+
+
+for numel in [int(s) for s in args.sizes.split(',')]:
+    torch.manual_seed(rank)
+    # Gradients of very different magnitude across ranks show the rounding of bf16/fp16 partial sums.
+    data = (torch.randn(numel, dtype=torch.float64) * 10 ** (rank % 4 - 2)).to(dtype)
+    reference = data.double()
+    dist.all_reduce(reference)
+    for mode in ['native', 'fp32', 'accum']:
+        span, out = run(data, mode)
+        err = (out.double() - reference).abs()
+        rel = (err.norm() / reference.norm()).item()
+        if rank == 0:
+            print('{:>10} elems {:>6}: {:.3f} ms, max err {:.3e}, rel err {:.3e}'.format(
+                numel, mode, span * 1e3, err.max().item(), rel))
+ccl.set_allreduce_fp32_accumulation(False)
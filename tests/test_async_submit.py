@@ -0,0 +1,55 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--buckets', type=int, default=16, help='number of gradient buckets')
+parser.add_argument('--bucket_mb', type=int, default=25)
+parser.add_argument('--iter', type=int, default=10, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+numel = args.bucket_mb * 1024 * 1024 // 4
+
+
+def run(async_submit):
+    opts = dist.ProcessGroupCCL.Options()
+    opts.async_submit = async_submit
+    group = dist.new_group(backend="ccl", pg_options=opts)
+    buckets = [torch.ones(numel) for _ in range(args.buckets)]
+    dist.barrier(group=group)
+
+    issue = 0.0
+    start = time.time()
+    for _ in range(args.iter):
+        for b in buckets:
+            b.fill_(1.0)
+        works = []
+        for b in buckets:
+            t0 = time.time()
+            works.append(dist.all_reduce(b, group=group, async_op=True))
+            issue += time.time() - t0
+        for w in works:
+            w.wait()
+    total = (time.time() - start) / args.iter
+    assert all(torch.all(b == size) for b in buckets)
+    return issue / (args.iter * args.buckets), total
+
+
+for async_submit in [False, True]:
+    issue, total = run(async_submit)
+    if rank == 0:
+        print('async_submit={}: {:.1f} us per all_reduce(async_op=True) call, {:.3f} ms per step'.format(
+            async_submit, issue * 1e6, total * 1e3))
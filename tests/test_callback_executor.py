@@ -0,0 +1,56 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--numel', type=int, default=1024 * 1024)
+parser.add_argument('--callback_ms', type=float, default=5.0, help='time spent in each future callback')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+
+
+def heavy_callback(fut):
+    # Stands in for a comm hook doing real work with the result.
+    end = time.time() + args.callback_ms / 1e3
+    while time.time() < end:
+        pass
+    return fut.value()
+
+
+def run(callback_threads):
+    opts = dist.ProcessGroupCCL.Options()
+    opts.callback_threads = callback_threads
+    group = dist.new_group(backend="ccl", pg_options=opts)
+    tensors = [torch.ones(args.numel) for _ in range(args.iter)]
+    dist.barrier(group=group)
+
+    start = time.time()
+    works = [dist.all_reduce(t, group=group, async_op=True) for t in tensors]
+    futs = [w.get_future().then(heavy_callback) for w in works]
+    for w in works:
+        w.wait()
+        assert w.get_future().done(), "wait() returned before the future was marked"
+    waited = time.time() - start
+    torch.futures.wait_all(futs)
+    total = time.time() - start
+    stats = group._get_backend(torch.device("cpu")).callback_stats()
+    return waited, total, stats
+
+
+for threads in [0, 1, 4]:
+    waited, total, stats = run(threads)
+    if rank == 0:
+        print('callback threads {}: all works completed after {:.3f} ms, all callbacks after {:.3f} ms, {}'.format(
+            threads, waited * 1e3, total * 1e3, stats))
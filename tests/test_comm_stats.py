@@ -0,0 +1,41 @@
+import os
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch
+from oneccl_bindings_for_pytorch import stats
+
+os.environ['TORCH_CCL_STATS_SHM'] = '1'
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+numel = 1024 * 1024
+x = torch.ones(numel)
+for _ in range(10):
+    dist.all_reduce(x)
+works = [dist.broadcast(torch.ones(numel), 0, async_op=True) for _ in range(4)]
+for w in works:
+    w.wait()
+dist.barrier()
+
+mine = [s for s in stats.collect() if s["pid"] == os.getpid()]
+assert len(mine) == 1, mine
+s = mine[0]
+allreduce = stats.OP_NAMES.index("allreduce")
+broadcast = stats.OP_NAMES.index("broadcast")
+assert s["rank"] == rank and s["size"] == size
+assert s["ops"][allreduce] == 10 and s["bytes"][allreduce] == 10 * numel * 4, s
+assert s["ops"][broadcast] == 4, s
+assert s["errors"] == 0, s
+assert s["in_flight"] == s["issued"] - s["completed"], s
+dist.barrier()
+
+if rank == 0:
+    print(stats.format_report(stats.collect()))
+    print("PASS")
@@ -0,0 +1,112 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+from torch.utils.cpp_extension import load_inline
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--numel', type=int, default=1 << 20)
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+
+def inputs(r, n=1001):
+    # Every rank can rebuild every rank's input, and n does not divide evenly.
+    gen = torch.Generator().manual_seed(r)
+    return torch.randn(n, generator=gen) * 10
+
+
+everyone = torch.stack([inputs(r) for r in range(size)])
+
+x = inputs(rank)
+ccl.allreduce_custom(x, "logsumexp")
+assert torch.allclose(x, torch.logsumexp(everyone, 0), atol=1e-5)
+
+pairs = torch.stack([inputs(rank), torch.full((1001,), float(rank))], -1)
+ccl.allreduce_custom(pairs, "max_with_index")
+values, indices = everyone.max(0)
+assert torch.equal(pairs[:, 0], values) and torch.equal(pairs[:, 1].long(), indices)
+
+small = torch.full((1001,), 1e-4 * (rank + 1)).bfloat16()
+kahan = torch.stack([small, torch.zeros_like(small)], -1)
+ccl.allreduce_custom(kahan, "kahan_sum")
+exact = sum(torch.full((1001,), 1e-4 * (r + 1)).bfloat16().double() for r in range(size))
+assert ((kahan.double().sum(-1) - exact).abs() <= 1e-2 * exact).all()
+
+if int(torch.__version__.split('.')[0]) >= 2:
+    y = inputs(rank)
+    dist.all_reduce(y, op=dist._make_nccl_premul_sum(1.0 / size))
+    assert torch.allclose(y, everyone.mean(0), atol=1e-5)
+
+# A reduction registered by an extension.
+source = r'''
+#include <torch/extension.h>
+#include <custom_reduction.h>
+
+void register_absmax() {
+  oneccl_bindings_for_pytorch::registerReduction(
+      "absmax", [](const void* in, void* inout, int64_t count, at::ScalarType dtype) {
+        TORCH_CHECK(dtype == at::kFloat, "absmax: float only");
+        auto src = static_cast<const float*>(in);
+        auto dst = static_cast<float*>(inout);
+        for (int64_t i = 0; i < count; i++) {
+          dst[i] = std::max(std::abs(dst[i]), std::abs(src[i]));
+        }
+      });
+}
+
+PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
+  m.def("register_absmax", &register_absmax);
+}
+'''
+pkg = os.path.dirname(ccl.__file__)
+ext = load_inline('ccl_custom_reduction_ext', cpp_sources=source, extra_cflags=['-O2'],
+                  extra_include_paths=[os.path.join(pkg, 'include')],
+                  extra_ldflags=['-L' + os.path.join(pkg, 'lib'), '-loneccl_bindings_for_pytorch'])
+ext.register_absmax()
+assert "absmax" in ccl.custom_reductions()
+z = inputs(rank)
+ccl.allreduce_custom(z, "absmax")
+assert torch.equal(z, everyone.abs().max(0)[0])
+
+# Log-sum-exp merge as one op against an allgather and a local reduce.
+t = torch.randn(args.numel)
+gathered = torch.empty(size, args.numel)
+
+
+def custom():
+    ccl.allreduce_custom(t.clone(), "logsumexp")
+
+
+def allgather():
+    dist.all_gather_into_tensor(gathered, t)
+    torch.logsumexp(gathered, 0)
+
+
+def timed(fn):
+    for _ in range(args.warm):
+        fn()
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        fn()
+    return (time.time() - start) / args.iter
+
+
+custom_time, allgather_time = timed(custom), timed(allgather)
+if rank == 0:
+    print('{} ranks, {} elements logsumexp: allreduce_custom {:.3f} ms, allgather + local {:.3f} ms'.format(
+        size, args.numel, custom_time * 1e3, allgather_time * 1e3))
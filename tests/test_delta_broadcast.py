@@ -0,0 +1,67 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--numel', type=int, default=64 * 1024 * 1024, help='elements of the flat weights')
+parser.add_argument('--block_bytes', type=int, default=64 * 1024)
+parser.add_argument('--iter', type=int, default=10, help='#updates per change rate')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+
+torch.manual_seed(0)
+weights = torch.randn(args.numel) if rank == 0 else torch.zeros(args.numel)
+nblocks = (weights.numel() * weights.element_size() + args.block_bytes - 1) // args.block_bytes
+block_elems = args.block_bytes // weights.element_size()
+
+
+def update(changed_blocks, changed_elems):
+    # An optimizer step which only touches some blocks, and within them
+    # only some elements, as with frozen layers or sparse embeddings.
+    if rank != 0:
+        return
+    for b in torch.randperm(nblocks)[:changed_blocks].tolist():
+        block = weights[b * block_elems:(b + 1) * block_elems]
+        idx = torch.randperm(block.numel())[:max(1, int(block.numel() * changed_elems))]
+        block[idx] += 1e-3 * torch.randn(idx.numel())
+
+
+def check():
+    expected = weights.clone()
+    dist.broadcast(expected, 0)
+    assert torch.equal(weights, expected), "receiver weights diverged"
+
+
+for xor in [False, True]:
+    ccl.reset_broadcast_delta()
+    ccl.broadcast_delta(weights, 0, block_bytes=args.block_bytes, xor=xor)
+    check()
+    for changed in [0.0, 0.01, 0.1, 0.5]:
+        for changed_elems in [0.05, 1.0]:
+            full = delta = 0.0
+            for _ in range(args.iter):
+                update(int(nblocks * changed), changed_elems)
+                dist.barrier()
+                start = time.time()
+                ccl.broadcast_delta(weights, 0, block_bytes=args.block_bytes, xor=xor)
+                delta += time.time() - start
+                check()
+                dist.barrier()
+                start = time.time()
+                dist.broadcast(weights, 0)
+                full += time.time() - start
+            if rank == 0:
+                print('xor {:d}, {:4.0%} of blocks with {:4.0%} of elements changed: full {:.2f} ms, '
+                      'delta {:.2f} ms'.format(xor, changed, changed_elems,
+                                               full / args.iter * 1e3, delta / args.iter * 1e3))
@@ -0,0 +1,56 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--hidden', type=int, default=4096, help='hidden size of the decoder')
+parser.add_argument('--layers', type=int, default=32, help='allreduces per token are 2 * layers')
+parser.add_argument('--tokens', type=int, default=64, help='decoded tokens')
+parser.add_argument('--batch', type=int, default=1)
+parser.add_argument('--warm', type=int, default=8, help='#warmup tokens')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+# One attention and one MLP output allreduce per layer and token, as in
+# tensor parallel decoding.
+x = torch.full((args.batch, args.hidden), float(rank + 1), dtype=torch.bfloat16)
+expected = size * (size + 1) / 2
+
+
+def decode(allreduce, tokens):
+    for _ in range(tokens):
+        for _ in range(2 * args.layers):
+            x.fill_(rank + 1)
+            allreduce(x)
+    assert x[0, 0].item() == expected, x[0, 0].item()
+
+
+def run(name, allreduce):
+    decode(allreduce, args.warm)
+    dist.barrier()
+    start = time.time()
+    decode(allreduce, args.tokens)
+    span = time.time() - start
+    calls = args.tokens * 2 * args.layers
+    if rank == 0:
+        print('{:>16}: {:.2f} us/allreduce, {:.2f} ms/token'.format(
+            name, span / calls * 1e6, span / args.tokens * 1e3))
+    return span
+
+
+base = run('dist.all_reduce', dist.all_reduce)
+direct = run('ccl.allreduce_', ccl.allreduce_)
+if rank == 0:
+    print('saving {:.2f} us/allreduce'.format((base - direct) / (args.tokens * 2 * args.layers) * 1e6))
@@ -0,0 +1,78 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--sizes', type=str, default='4,64,512', help='bucket sizes in MB')
+parser.add_argument('--numa_node', type=int, default=-1, help='NUMA node to bind the huge page buckets to')
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+
+
+def huge_page_kb():
+    total = 0
+    with open('/proc/self/smaps_rollup') as f:
+        for line in f:
+            if line.startswith(('AnonHugePages:', 'Private_Hugetlb:')):
+                total += int(line.split()[1])
+    return total
+
+
+def alloc(numel, mode):
+    if mode == 'hugepage':
+        return ccl.empty_hugepage(numel, torch.float32, args.numa_node)
+    return torch.empty(numel, dtype=torch.float32)
+
+
+for mb in [int(s) for s in args.sizes.split(',')]:
+    numel = mb * 1024 * 1024 // 4
+    for mode in ['4k', 'hugepage']:
+        before = huge_page_kb()
+        start = time.time()
+        bucket = alloc(numel, mode)
+        bucket.fill_(1.0)
+        touch = time.time() - start
+        huge = huge_page_kb() - before
+
+        for _ in range(args.warm):
+            dist.all_reduce(bucket)
+        dist.barrier()
+        start = time.time()
+        for _ in range(args.iter):
+            dist.all_reduce(bucket)
+        span = (time.time() - start) / args.iter
+        if rank == 0:
+            print('{:>5} MB {:>8}: first touch {:.3f} ms, allreduce {:.3f} ms ({:.2f} GB/s), {} MB on huge pages'.format(
+                mb, mode, touch * 1e3, span * 1e3, mb / 1024 / span, huge // 1024))
+        del bucket
+
+# bf16 allreduces with fp32 accumulation stage their chunks in comm buffers,
+# which come from the pool of released huge page regions after the first op.
+ccl.set_allreduce_fp32_accumulation(True)
+for mb in [int(s) for s in args.sizes.split(',')]:
+    bucket = torch.ones(mb * 1024 * 1024 // 2, dtype=torch.bfloat16)
+    start = time.time()
+    dist.all_reduce(bucket)
+    first = time.time() - start
+    for _ in range(args.warm):
+        dist.all_reduce(bucket)
+    start = time.time()
+    for _ in range(args.iter):
+        dist.all_reduce(bucket)
+    span = (time.time() - start) / args.iter
+    if rank == 0:
+        print('{:>5} MB staged bf16 allreduce: first {:.3f} ms, then {:.3f} ms'.format(mb, first * 1e3, span * 1e3))
+ccl.set_allreduce_fp32_accumulation(False)
@@ -0,0 +1,68 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--mb', type=int, default=256, help='MB broadcast, e.g. a weight shard')
+parser.add_argument('--kv_mb', type=int, default=16, help='MB allgathered per rank, e.g. a KV block')
+parser.add_argument('--iter', type=int, default=5, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+src = size - 1
+
+weights = torch.arange(args.mb * 1024 * 256, dtype=torch.float32)
+shape_only = weights if rank == src else torch.empty(weights.shape, device='meta')
+shared = ccl.broadcast_node_shared(shape_only, src)
+assert torch.equal(shared, weights)
+
+block = torch.full((args.kv_mb * 1024 * 256 // 4, 4), float(rank))
+gathered = ccl.all_gather_into_tensor_node_shared(block)
+expected = torch.cat([torch.full_like(block, float(r)) for r in range(size)])
+assert torch.equal(gathered, expected)
+del shared, gathered
+
+
+def timed(fn):
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        out = fn()
+        del out
+    return (time.time() - start) / args.iter
+
+
+def private_broadcast():
+    out = weights.clone() if rank == src else torch.empty_like(weights)
+    dist.broadcast(out, src)
+    return out
+
+
+def private_allgather():
+    out = torch.empty(size * block.shape[0], 4)
+    dist.all_gather_into_tensor(out, block)
+    return out
+
+
+bcast_private = timed(private_broadcast)
+bcast_shared = timed(lambda: ccl.broadcast_node_shared(shape_only, src))
+ag_private = timed(private_allgather)
+ag_shared = timed(lambda: ccl.all_gather_into_tensor_node_shared(block))
+if rank == 0:
+    print('broadcast {} MB: private copies {:.1f} ms, node shared {:.1f} ms'.format(
+        args.mb, bcast_private * 1e3, bcast_shared * 1e3))
+    print('allgather {} MB per rank: private copies {:.1f} ms, node shared {:.1f} ms'.format(
+        args.kv_mb, ag_private * 1e3, ag_shared * 1e3))
+    print('host memory per node for the outputs: {} copies become 1'.format(
+        int(os.environ.get('MPI_LOCALNRANKS', size))))
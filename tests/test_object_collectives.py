@@ -0,0 +1,78 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=50, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+
+def make_object(nbytes):
+    # A sampler state or checkpoint manifest like object whose size differs per rank.
+    n = max(1, nbytes // 16 * (rank + 1) // size)
+    return {'rank': rank, 'indices': list(range(n)), 'shard': 'model-{:05d}.bin'.format(rank)}
+
+
+def timed(fn):
+    for _ in range(args.warm):
+        fn()
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        fn()
+    return (time.time() - start) / args.iter
+
+
+# Variable size tensors, including empty ones.
+for n in [0, 1, 100, 1021, 5000, 1 << 20]:
+    local = torch.arange(n * rank, n * rank + n * (rank % 2 + 1), dtype=torch.float32)
+    gathered = ccl.allgatherv(local)
+    for r, t in enumerate(gathered):
+        assert torch.equal(t, torch.arange(n * r, n * r + n * (r % 2 + 1), dtype=torch.float32))
+    root_data = torch.arange(n, dtype=torch.int64) if rank == 0 else torch.empty(0, dtype=torch.int64)
+    assert torch.equal(ccl.broadcast_with_size(root_data, 0), torch.arange(n, dtype=torch.int64))
+
+# Async: both ops are in flight before the first wait.
+mine = torch.full((rank + 1,), rank, dtype=torch.uint8)
+ag = ccl.allgatherv(mine, async_op=True)
+bc = ccl.broadcast_with_size(mine if rank == 0 else torch.empty(0, dtype=torch.uint8), 0, async_op=True)
+ag.wait()
+bc.wait()
+data, sizes = ag.result()
+assert sizes.tolist() == list(range(1, size + 1))
+assert torch.equal(data, torch.cat([torch.full((r + 1,), r, dtype=torch.uint8) for r in range(size)]))
+assert torch.equal(bc.result()[0], torch.zeros(1, dtype=torch.uint8))
+
+for nbytes in [64, 1024, 16 * 1024, 1024 * 1024]:
+    obj = make_object(nbytes)
+    expected = [None] * size
+    result = [None] * size
+    dist.all_gather_object(expected, obj)
+    ccl.all_gather_object(result, obj)
+    assert result == expected
+    objs = [obj, nbytes] if rank == 0 else [None, None]
+    ccl.broadcast_object_list(objs, src=0)
+    assert objs[1] == nbytes and objs[0]['rank'] == 0
+
+    out = [None] * size
+    torch_ag = timed(lambda: dist.all_gather_object(out, obj))
+    ccl_ag = timed(lambda: ccl.all_gather_object(out, obj))
+    torch_bc = timed(lambda: dist.broadcast_object_list([obj], src=0))
+    ccl_bc = timed(lambda: ccl.broadcast_object_list([obj], src=0))
+    if rank == 0:
+        print('{:>8} B objects: all_gather_object {:.1f} -> {:.1f} us, broadcast_object_list {:.1f} -> {:.1f} us'.format(
+            nbytes, torch_ag * 1e6, ccl_ag * 1e6, torch_bc * 1e6, ccl_bc * 1e6))
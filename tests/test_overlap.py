@@ -0,0 +1,136 @@
+import argparse
+import os
+import time
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--workload', choices=['matmul', 'transformer'], default='transformer')
+parser.add_argument('--dim', type=int, default=1024, help='matmul size / transformer d_model')
+parser.add_argument('--layers', type=int, default=4, help='matmuls / transformer layers per step')
+parser.add_argument('--tokens', type=int, default=2048, help='transformer tokens per step')
+parser.add_argument('--buckets', type=int, default=8, help='gradient buckets per step')
+parser.add_argument('--bucket_mb', type=int, default=25)
+parser.add_argument('--ccl_workers', type=int, default=1, help='oneCCL workers per rank (CCL_WORKER_COUNT)')
+parser.add_argument('--pin', action='store_true', default=False,
+                    help='split the cores of each rank between the oneCCL workers and the compute threads')
+parser.add_argument('--warm', type=int, default=3, help='#warmup')
+parser.add_argument('--iter', type=int, default=10, help='#iteration')
+args = parser.parse_args()
+
+# oneCCL reads its worker settings at initialization, so they are set before
+# the bindings are imported.
+local_rank = int(os.environ.get('MPI_LOCALRANKID', os.environ.get('LOCAL_RANK', 0)))
+local_size = int(os.environ.get('MPI_LOCALNRANKS', os.environ.get('LOCAL_WORLD_SIZE', 1)))
+os.environ['CCL_WORKER_COUNT'] = str(args.ccl_workers)
+compute_cores = None
+if args.pin:
+    cores = sorted(os.sched_getaffinity(0))
+    per_rank = len(cores) // local_size
+    assert per_rank > args.ccl_workers, 'not enough cores to pin {} workers per rank'.format(args.ccl_workers)
+    # The workers take the last cores of each rank's slice, compute the rest.
+    affinity = []
+    for r in range(local_size):
+        rank_cores = cores[r * per_rank:(r + 1) * per_rank]
+        affinity += rank_cores[-args.ccl_workers:]
+        if r == local_rank:
+            compute_cores = rank_cores[:-args.ccl_workers]
+    os.environ['CCL_WORKER_AFFINITY'] = ','.join(str(c) for c in affinity)
+    os.sched_setaffinity(0, compute_cores)
+
+import torch
+import torch.nn as nn
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch
+
+if compute_cores is not None:
+    torch.set_num_threads(len(compute_cores))
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+torch.manual_seed(0)
+if args.workload == 'matmul':
+    weights = [torch.randn(args.dim, args.dim) for _ in range(args.layers)]
+    x = torch.randn(args.dim, args.dim)
+
+    def compute():
+        y = x
+        for w in weights:
+            y = torch.mm(y, w).tanh_()
+        return y
+else:
+    model = nn.Sequential(*[nn.TransformerEncoderLayer(args.dim, args.dim // 64, batch_first=True)
+                            for _ in range(args.layers)])
+    x = torch.randn(args.tokens // 512, 512, args.dim)
+
+    def compute():
+        with torch.no_grad():
+            return model(x)
+
+buckets = [torch.ones(args.bucket_mb * 1024 * 1024 // 4) for _ in range(args.buckets)]
+
+
+def communicate():
+    return [dist.all_reduce(b, async_op=True) for b in buckets]
+
+
+def compute_only():
+    start = time.time()
+    compute()
+    return time.time() - start, None
+
+
+def comm_only():
+    start = time.time()
+    for w in communicate():
+        w.wait()
+    return time.time() - start, None
+
+
+def overlapped():
+    start = time.time()
+    works = communicate()
+    compute()
+    compute_done = time.time()
+    for w in works:
+        w.wait()
+    end = time.time()
+    return end - start, compute_done - start
+
+
+def average(fn):
+    for _ in range(args.warm):
+        fn()
+    total = [0.0, 0.0]
+    for _ in range(args.iter):
+        dist.barrier()
+        span, compute_span = fn()
+        total[0] += span
+        total[1] += compute_span or 0.0
+    return total[0] / args.iter, total[1] / args.iter
+
+
+t_compute, _ = average(compute_only)
+t_comm, _ = average(comm_only)
+t_total, t_compute_overlapped = average(overlapped)
+
+# Exposed communication is the part of the step the collectives add on top
+# of the compute alone. Overlap is the share of the shorter phase that was
+# hidden behind the other one.
+exposed = max(t_total - t_compute, 0.0)
+slowdown = t_compute_overlapped / t_compute - 1.0
+hidden = t_compute + t_comm - t_total
+overlap = min(max(hidden / min(t_compute, t_comm), 0.0), 1.0)
+
+if rank == 0:
+    print('{} ranks, {} workload, {} threads/rank, CCL_WORKER_COUNT={}, pinned={}, {} x {} MB buckets'.format(
+        size, args.workload, torch.get_num_threads(), args.ccl_workers, args.pin, args.buckets, args.bucket_mb))
+    print('compute {:.2f} ms, comm {:.2f} ms, overlapped step {:.2f} ms'.format(
+        t_compute * 1e3, t_comm * 1e3, t_total * 1e3))
+    print('exposed comm {:.2f} ms, compute slowdown {:.1f}%, overlap {:.1f}%'.format(
+        exposed * 1e3, slowdown * 100, overlap * 100))
@@ -0,0 +1,84 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--numel', type=int, default=1024 * 1024, help='gradient elements')
+parser.add_argument('--micro', type=int, default=8, help='micro-batches per step')
+parser.add_argument('--work_ms', type=float, default=10.0, help='compute time of one micro-batch')
+parser.add_argument('--slowdown', type=float, default=4.0, help='how much slower the last rank is')
+parser.add_argument('--deadline_ms', type=float, default=100.0)
+parser.add_argument('--max_staleness', type=int, default=2)
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+# The sum is exact, including what a rank held back in earlier calls.
+grad = torch.full((16,), float(rank + 1))
+contributors = ccl.allreduce_partial(grad, contribute=rank != 0)
+assert contributors.tolist() == [r != 0 for r in range(size)], contributors
+assert torch.equal(grad, torch.full((16,), float(sum(range(2, size + 1)))))
+grad = torch.full((16,), float(rank + 1))
+contributors = ccl.allreduce_partial(grad, contribute=True)
+assert contributors.all()
+assert torch.equal(grad, torch.full((16,), float(sum(range(1, size + 1)) + 1)))
+
+micro_ms = args.work_ms * (args.slowdown if rank == size - 1 else 1.0)
+
+
+def micro_batch(grad):
+    time.sleep(micro_ms / 1e3)
+    grad.add_(1.0)
+
+
+def step_full(grad):
+    for _ in range(args.micro):
+        micro_batch(grad)
+    dist.all_reduce(grad)
+    grad.div_(size)
+
+
+def step_bounded(state, grad):
+    state.start()
+    done = 0
+    for _ in range(args.micro):
+        if state.expired():
+            break
+        micro_batch(grad)
+        done += 1
+    return state.allreduce(grad, complete=done == args.micro)
+
+
+grad = torch.zeros(args.numel)
+dist.barrier()
+start = time.time()
+for _ in range(args.iter):
+    grad.zero_()
+    step_full(grad)
+full = (time.time() - start) / args.iter
+
+state = ccl.BoundedStaleness(args.deadline_ms / 1e3, args.max_staleness)
+contributed = torch.zeros(size)
+dist.barrier()
+start = time.time()
+for _ in range(args.iter):
+    grad.zero_()
+    contributed += step_bounded(state, grad).float()
+bounded = (time.time() - start) / args.iter
+state.reset()
+
+if rank == 0:
+    print('full allreduce: {:.1f} ms/step, bounded staleness: {:.1f} ms/step, contributions per rank: {}'.format(
+        full * 1e3, bounded * 1e3, contributed.int().tolist()))
@@ -0,0 +1,89 @@
+import os
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+# Two groups of the same job with different settings.
+tp_opts = dist.ProcessGroupCCL.Options()
+tp_opts.priority = 1
+tp_opts.allreduce_fp32_accum = True
+tp_opts.max_in_flight = 2
+tp_group = dist.new_group(backend="ccl", pg_options=tp_opts)
+
+dp_opts = dist.ProcessGroupCCL.Options()
+dp_opts.allgather_quant = "int8"
+dp_opts.allgather_quant_block = 128
+dp_opts.batch_max_ops = 4
+dp_group = dist.new_group(backend="ccl", pg_options=dp_opts)
+
+tp_backend = tp_group._get_backend(torch.device("cpu"))
+dp_backend = dp_group._get_backend(torch.device("cpu"))
+assert tp_backend.options.priority == 1
+assert tp_backend.allreduce_fp32_accumulation
+assert not dp_backend.allreduce_fp32_accumulation
+assert dp_backend.options.allgather_quant == "int8"
+
+x = torch.ones(1000, dtype=torch.bfloat16) * (rank + 1)
+dist.all_reduce(x, group=tp_group)
+assert torch.all(x.float() == size * (size + 1) / 2)
+
+# More async ops than the group lets in flight.
+xs = [torch.ones(1000) for _ in range(8)]
+works = [dist.all_reduce(t, group=tp_group, async_op=True) for t in xs]
+for w, t in zip(works, xs):
+    w.wait()
+    assert torch.all(t == size)
+
+# Callbacks run on the progress thread chain allreduces past the in-flight
+# limit instead of waiting for a slot only that thread can free.
+chain_opts = dist.ProcessGroupCCL.Options()
+chain_opts.callback_threads = 0
+chain_opts.max_in_flight = 1
+chain_group = dist.new_group(backend="ccl", pg_options=chain_opts)
+chained = []
+
+
+def chain(fut):
+    y = torch.ones(1000)
+    chained.append((dist.all_reduce(y, group=chain_group, async_op=True), y))
+    return fut.value()
+
+
+xs = [torch.ones(1000) for _ in range(8)]
+futs = [dist.all_reduce(t, group=chain_group, async_op=True).get_future().then(chain) for t in xs]
+torch.futures.wait_all(futs)
+for w, y in chained:
+    w.wait()
+    assert torch.all(y == size)
+assert len(chained) == len(xs)
+
+# Per group options do not touch the process environment.
+llm_opts = dist.ProcessGroupCCL.Options()
+llm_opts.llm_allreduce = True
+llm_group = dist.new_group(backend="ccl", pg_options=llm_opts)
+if os.environ.get("TORCH_LLM_ALLREDUCE", "0") == "0":
+    assert "CCL_SKIP_SCHEDULER" not in os.environ
+assert dp_backend.options.llm_allreduce is None and dp_backend.options.batch_max_ops == 4
+
+# Shards below allgather_quant_min_bytes are gathered exactly.
+shard = torch.randn(1024)
+full = torch.empty(1024 * size)
+dist.all_gather_into_tensor(full, shard, group=dp_group)
+assert torch.equal(full.chunk(size)[rank], shard)
+
+oneccl_bindings_for_pytorch.set_allgather_quantization("int8", 128, group=dp_group, min_bytes=0)
+dist.all_gather_into_tensor(full, shard, group=dp_group)
+assert torch.allclose(full.chunk(size)[rank], shard, atol=shard.abs().max().item() / 127)
+
+if rank == 0:
+    print("PASS")
@@ -0,0 +1,71 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.nn as nn
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--layers', type=int, default=4, help='number of transformer layers')
+parser.add_argument('--d_model', type=int, default=1024)
+parser.add_argument('--nhead', type=int, default=16)
+parser.add_argument('--block_size', type=int, default=256, help='elements sharing one scale')
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+parser.add_argument('--bf16', action='store_true', default=False)
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+dtype = torch.bfloat16 if args.bf16 else torch.float32
+torch.manual_seed(0)
+model = nn.Sequential(*[nn.TransformerEncoderLayer(args.d_model, args.nhead, batch_first=True)
+                        for _ in range(args.layers)]).to(dtype)
+model.eval()
+
+# FSDP style flat parameter, padded so that it divides evenly across ranks.
+flat = nn.utils.parameters_to_vector(model.parameters()).detach()
+numel = (flat.numel() + size - 1) // size * size
+full = torch.zeros(numel, dtype=dtype)
+full[:flat.numel()] = flat
+shard = full.chunk(size)[rank].clone()
+
+x = torch.randn(8, 128, args.d_model, dtype=dtype)
+with torch.no_grad():
+    reference = model(x).float()
+
+
+def run(quant):
+    output = torch.empty_like(full)
+    for _ in range(args.warm):
+        ccl.all_gather_into_tensor_quantized(output, shard, quant, args.block_size)
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        ccl.all_gather_into_tensor_quantized(output, shard, quant, args.block_size)
+    span = (time.time() - start) / args.iter
+
+    err = (output.float() - full.float()).abs()
+    nn.utils.vector_to_parameters(output[:flat.numel()], model.parameters())
+    with torch.no_grad():
+        out = model(x).float()
+    nn.utils.vector_to_parameters(flat, model.parameters())
+    fwd_err = ((out - reference).norm() / reference.norm()).item()
+    return span, err.max().item(), err.mean().item(), fwd_err
+
+
+for quant in ["none", "int8", "fp8"]:
+    span, max_err, mean_err, fwd_err = run(quant)
+    if rank == 0:
+        gbps = full.numel() * full.element_size() / span / 1e9
+        print('{:>5}: {:.3f} ms/allgather, {:.2f} GB/s of {} params, max err {:.3e}, mean err {:.3e}, '
+              'forward rel err {:.3e}'.format(quant, span * 1e3, gbps, dtype, max_err, mean_err, fwd_err))
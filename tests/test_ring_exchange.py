@@ -0,0 +1,95 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--seq', type=int, default=4096, help='tokens per rank')
+parser.add_argument('--heads', type=int, default=16)
+parser.add_argument('--head_dim', type=int, default=64)
+parser.add_argument('--warm', type=int, default=3, help='#warmup')
+parser.add_argument('--iter', type=int, default=10, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+# Every rank ends up with every rank's block, in ring order.
+block = torch.full((1024,), float(rank))
+ring = ccl.RingExchange(block)
+for step in range(1, size):
+    ring.start()
+    ring.wait()
+    assert torch.equal(ring.current, torch.full((1024,), float((rank - step) % size))), step
+
+torch.manual_seed(rank)
+q = torch.randn(args.heads, args.seq, args.head_dim)
+kv = torch.randn(2, args.heads, args.seq, args.head_dim)
+
+
+def attend(q, kv, out):
+    # Unnormalized blockwise attention, enough to have compute to overlap.
+    scores = torch.matmul(q, kv[0].transpose(-1, -2)).softmax(-1)
+    out.add_(torch.matmul(scores, kv[1]))
+
+
+def separate():
+    # One hop as two ops, the receive only posted once the send is done.
+    out = torch.zeros_like(q)
+    current, received = kv.clone(), torch.empty_like(kv)
+    for step in range(size):
+        attend(q, current, out)
+        if step + 1 < size:
+            if rank % 2 == 0:
+                dist.send(current, (rank + 1) % size)
+                dist.recv(received, (rank - 1) % size)
+            else:
+                dist.recv(received, (rank - 1) % size)
+                dist.send(current, (rank + 1) % size)
+            current, received = received, current
+    return out
+
+
+def fused():
+    out = torch.zeros_like(q)
+    ring = ccl.RingExchange(kv)
+    for step in range(size):
+        if step + 1 < size:
+            ring.start()
+        attend(q, ring.current, out)
+        if step + 1 < size:
+            ring.wait()
+    return out
+
+
+def timed(fn):
+    for _ in range(args.warm):
+        fn()
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        out = fn()
+    return (time.time() - start) / args.iter, out
+
+
+ring_time, ring_out = timed(fused)
+try:
+    sep_time, sep_out = timed(separate)
+    assert torch.allclose(ring_out, sep_out)
+except RuntimeError as e:
+    sep_time = float('nan')
+    if rank == 0:
+        print('send/recv unavailable: {}'.format(e))
+if rank == 0:
+    mb = kv.numel() * kv.element_size() / 1e6
+    print('{} ranks, {:.1f} MB per hop: send + recv {:.2f} ms/step, RingExchange {:.2f} ms/step'.format(
+        size, mb, sep_time * 1e3, ring_time * 1e3))
@@ -0,0 +1,80 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+from oneccl_bindings_for_pytorch import _C as ccl_lib
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--numel', type=int, default=4 * 1024 * 1024, help='elements per rank')
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+parser.add_argument('--bf16', action='store_true', default=False)
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+pg = dist.distributed_c10d._get_default_group()._get_backend(torch.device("cpu"))
+
+dtype = torch.bfloat16 if args.bf16 else torch.float32
+numel = args.numel // size * size
+
+
+def activation(density):
+    # ReLU output with the given fraction of nonzeros.
+    torch.manual_seed(rank)
+    x = torch.randn(numel, dtype=dtype)
+    return torch.where(torch.rand(numel) < density, x.abs() + 1, torch.zeros_like(x))
+
+
+def timed(fn):
+    for _ in range(args.warm):
+        fn()
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        fn()
+    return (time.time() - start) / args.iter
+
+
+def codec(x):
+    encoded = ccl_lib._sparse_encode(x)
+    out = torch.empty_like(x)
+    enc = timed(lambda: ccl_lib._sparse_encode(x))
+    dec = timed(lambda: ccl_lib._sparse_decode(encoded, out))
+    assert torch.equal(out, x)
+    return encoded.numel() / (x.numel() * x.element_size()), enc, dec
+
+
+def run(x, sparse):
+    pg.sparse_comm = sparse
+    gathered = torch.empty(numel * size, dtype=dtype)
+    exchanged = torch.empty_like(x)
+    ag = timed(lambda: dist.all_gather_into_tensor(gathered, x))
+    a2a = timed(lambda: dist.all_to_all_single(exchanged, x))
+    return gathered, exchanged, ag, a2a
+
+
+nbytes = numel * torch.tensor([], dtype=dtype).element_size()
+for density in [0.0, 0.1, 0.3, 0.5, 0.7, 0.9, 1.0]:
+    x = activation(density)
+    ratio, enc, dec = codec(x)
+    dense_ag, dense_a2a, ag, a2a = run(x, False)
+    sparse_ag, sparse_a2a, sag, sa2a = run(x, True)
+    # The encoding is lossless, results have to match bit for bit.
+    assert torch.equal(dense_ag, sparse_ag), "allgather mismatch at density {}".format(density)
+    assert torch.equal(dense_a2a, sparse_a2a), "alltoall mismatch at density {}".format(density)
+    if rank == 0:
+        print('density {:.1f}: ratio {:.3f}, encode {:.2f} GB/s, decode {:.2f} GB/s, '
+              'allgather {:.2f} -> {:.2f} GB/s, alltoall {:.2f} -> {:.2f} GB/s'.format(
+                  density, ratio, nbytes / enc / 1e9, nbytes / dec / 1e9,
+                  nbytes * size / ag / 1e9, nbytes * size / sag / 1e9,
+                  nbytes / a2a / 1e9, nbytes / sa2a / 1e9))
@@ -0,0 +1,84 @@
+import argparse
+import os
+import time
+
+import torch
+import torch.nn as nn
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+from torch.nn.parallel import DistributedDataParallel as DDP
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--ratios', type=str, default='0.001,0.01,0.1', help='top-k ratios to compare with dense')
+parser.add_argument('--steps', type=int, default=300, help='#training steps of the convergence run')
+parser.add_argument('--hidden', type=int, default=1024)
+parser.add_argument('--warm', type=int, default=5, help='#warmup')
+parser.add_argument('--iter', type=int, default=20, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+ratios = [float(r) for r in args.ratios.split(',')]
+
+
+def train(ratio):
+    # Regression of a fixed random teacher MLP, every rank on its own data.
+    torch.manual_seed(0)
+    teacher = nn.Sequential(nn.Linear(64, args.hidden), nn.ReLU(), nn.Linear(args.hidden, 1))
+    model = DDP(nn.Sequential(nn.Linear(64, args.hidden), nn.ReLU(), nn.Linear(args.hidden, 1)))
+    if ratio is not None:
+        ccl_backend = dist.distributed_c10d._get_default_group()._get_backend(torch.device("cpu"))
+        ccl_backend.clear_topk_residuals()
+        model.register_comm_hook(ccl.TopKState(ratio), ccl.topk_allreduce_hook)
+    opt = torch.optim.SGD(model.parameters(), lr=0.05, momentum=0.9)
+    torch.manual_seed(1 + rank)
+    start = time.time()
+    for step in range(args.steps):
+        x = torch.randn(256, 64)
+        with torch.no_grad():
+            y = teacher(x)
+        loss = nn.functional.mse_loss(model(x), y)
+        opt.zero_grad()
+        loss.backward()
+        opt.step()
+    span = time.time() - start
+    loss = loss.detach()
+    dist.all_reduce(loss)
+    return loss.item() / size, span / args.steps
+
+
+def throughput(numel, ratio):
+    grad = torch.randn(numel)
+    def run():
+        if ratio is None:
+            dist.all_reduce(grad)
+        else:
+            ccl.allreduce_topk(grad, ratio)
+    for _ in range(args.warm):
+        run()
+    dist.barrier()
+    start = time.time()
+    for _ in range(args.iter):
+        run()
+    return (time.time() - start) / args.iter
+
+
+for ratio in [None] + ratios:
+    loss, span = train(ratio)
+    if rank == 0:
+        print('{:>6}: final loss {:.5f}, {:.2f} ms/step'.format(
+            'dense' if ratio is None else ratio, loss, span * 1e3))
+
+for numel in [1 << 16, 1 << 20, 1 << 24]:
+    dense = throughput(numel, None)
+    line = '{:>9} floats: dense {:.2f} ms'.format(numel, dense * 1e3)
+    for ratio in ratios:
+        line += ', top-k {} {:.2f} ms'.format(ratio, throughput(numel, ratio) * 1e3)
+    if rank == 0:
+        print(line)
@@ -0,0 +1,45 @@
+import os
+import time
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch
+
+os.environ.setdefault('TORCH_CCL_WATCHDOG_INTERVAL_MS', '100')
+os.environ.setdefault('TORCH_CCL_SLOW_OP_MIN_MS', '200')
+os.environ.setdefault('TORCH_CCL_WATCHDOG_DUMP_SIGNAL', '10')
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+backend = dist.group.WORLD._get_backend(torch.device("cpu"))
+
+# Warm up the latency histogram so the threshold follows the p99.
+x = torch.ones(1024 * 1024)
+for _ in range(64):
+    dist.all_reduce(x)
+
+# The last rank joins late, so the allreduce is slow on all other ranks and
+# the watchdog logs it on stderr.
+work = None
+if rank != size - 1:
+    work = dist.all_reduce(x, async_op=True)
+    time.sleep(1)
+    table = backend.dump_in_flight()
+    print(table)
+    assert "ops in flight" in table and "age" in table, table
+    # The same table goes to stderr on the dump signal.
+    os.kill(os.getpid(), 10)
+    time.sleep(0.5)
+else:
+    time.sleep(1.5)
+    work = dist.all_reduce(x, async_op=True)
+work.wait()
+dist.barrier()
+
+if rank == 0:
+    print("PASS")
@@ -0,0 +1,52 @@
+import argparse
+import os
+import resource
+
+import torch
+import torch.distributed as dist
+import oneccl_bindings_for_pytorch as ccl
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--buckets', type=int, default=64, help='number of gradient buckets')
+parser.add_argument('--bucket_mb', type=int, default=25)
+parser.add_argument('--iter', type=int, default=5, help='#iteration')
+args = parser.parse_args()
+
+os.environ['RANK'] = str(os.environ.get('PMI_RANK', 0))
+os.environ['WORLD_SIZE'] = str(os.environ.get('PMI_SIZE', 1))
+os.environ['MASTER_ADDR'] = '127.0.0.1'
+os.environ['MASTER_PORT'] = '29500'
+
+dist.init_process_group("ccl")
+rank = dist.get_rank()
+size = dist.get_world_size()
+
+# bf16 with fp32 accumulation goes through staging buffers captured by the work.
+ccl.set_allreduce_fp32_accumulation(True)
+numel = args.bucket_mb * 1024 * 1024 // 2 + 1
+
+
+def rss_mb():
+    with open('/proc/self/statm') as f:
+        return int(f.read().split()[1]) * os.sysconf('SC_PAGE_SIZE') / 2**20
+
+
+held = []
+works = []
+for step in range(args.iter):
+    # Like DDP, the works of the previous iteration are only dropped here.
+    works = []
+    for _ in range(args.buckets):
+        grad = torch.ones(numel, dtype=torch.bfloat16)
+        works.append(dist.all_reduce(torch.narrow(grad, 0, 1, numel - 1), async_op=True))
+        del grad
+    for w in works:
+        w.wait()
+    before = rss_mb()
+    works = []
+    held.append(before - rss_mb())
+
+peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+if rank == 0:
+    print('{} buckets of {} MB: peak RSS {:.0f} MB, RSS held by completed works {:.0f} MB'.format(
+        args.buckets, args.bucket_mb, peak, max(held)))